@@ -351,7 +351,7 @@ namespace acommon {
         val += s;
         val += '\n';
       }
-      val.pop_back();
+      if (!val.empty()) val.pop_back();
       return val;
     }
   }
@@ -1387,6 +1387,14 @@ namespace acommon {
        N_("create dictionary aliases")}
     , {"dict-dir", KeyInfoString, DICT_DIR,
        N_("location of the main word list")}
+    , {"dict-hugepage", KeyInfoBool, "false",
+       N_("ask for huge pages for compiled dictionaries")}
+    , {"dict-mlock", KeyInfoBool, "false",
+       N_("lock compiled dictionaries in memory")}
+    , {"dict-populate", KeyInfoBool, "false",
+       N_("read all of a compiled dictionary when loading it")}
+    , {"dict-willneed", KeyInfoBool, "false",
+       N_("start reading compiled dictionaries in the background")}
     , {"encoding",   KeyInfoString, "!encoding",
        N_("encoding to expect data to be in"), KEYINFO_COMMON}
     , {"filter",   KeyInfoList  , "url",
@@ -1459,6 +1467,8 @@ namespace acommon {
        N_("minimal length of interior words"), KEYINFO_MAY_CHANGE}
     , {"camel-case", KeyInfoBool,  "false",
        N_("consider camel case words legal"), KEYINFO_MAY_CHANGE}
+    , {"check-cache-size", KeyInfoInt, "0",
+       N_("number of check results to cache, 0 = none"), KEYINFO_MAY_CHANGE}
     , {"save-repl", KeyInfoBool  , "true",
        N_("save replacement pairs on save all")}
     , {"set-prefix", KeyInfoBool, "true",
@@ -1467,6 +1477,13 @@ namespace acommon {
        N_("size of the word list")}
     , {"spelling",   KeyInfoString, "",
        N_("no longer used"), KEYINFO_HIDDEN}
+    , {"sug-cache-size", KeyInfoInt, "0",
+       N_("number of suggestion lists to cache, 0 = none"), KEYINFO_MAY_CHANGE}
+    , {"sug-deadline-us", KeyInfoInt, "0",
+       N_("microseconds to spend on suggestions at most, 0 = no limit"),
+       KEYINFO_MAY_CHANGE}
+    , {"sug-freq-stop", KeyInfoInt, "0",
+       N_("stop once this many common suggestions are found, 0 = never")}
     , {"sug-mode",   KeyInfoString, "normal",
        N_("suggestion mode"), KEYINFO_MAY_CHANGE | KEYINFO_COMMON}
     , {"sug-typo-analysis", KeyInfoBool, "true",
@@ -1475,6 +1492,8 @@ namespace acommon {
        N_("use typo analysis, override sug-mode default")}
     , {"sug-repl-table", KeyInfoBool, "true",
        N_("use replacement tables, override sug-mode default")}
+    , {"sug-scan-threads", KeyInfoInt, "1",
+       N_("number of threads to scan the dictionary with for suggestions")}
     , {"sug-split-char", KeyInfoList, "\\ :-",
        N_("characters to insert when a word is split"), KEYINFO_UTF8}
     , {"use-other-dicts", KeyInfoBool, "true",
@@ -1497,20 +1516,40 @@ namespace acommon {
        N_("indicator for affix flags in word lists -- CURRENTLY IGNORED"), KEYINFO_UTF8 | KEYINFO_HIDDEN}
     , {"affix-compress", KeyInfoBool, "false",
        N_("use affix compression when creating dictionaries")}
+    , {"bloom-filter",  KeyInfoBool, "false",
+       N_("add a filter to quickly reject unknown words")}
+    , {"bucket-hash",  KeyInfoBool, "false",
+       N_("use a cache friendly hash table layout")}
     , {"clean-affixes", KeyInfoBool, "true",
        N_("remove invalid affix flags")}
     , {"clean-words", KeyInfoBool, "false",
        N_("attempts to clean words so that they are valid")}
+    , {"create-memory",  KeyInfoInt, "0",
+       N_("MiB of word data to keep in memory when creating, 0 = no limit")}
+    , {"create-threads",  KeyInfoInt, "1",
+       N_("threads to use when creating dictionaries")}
+    , {"deletion-index",  KeyInfoBool, "false",
+       N_("add an index for the \"indexed\" sug-mode")}
+    , {"front-code",  KeyInfoBool, "false",
+       N_("store the soundslike strings front coded")}
     , {"invisible-soundslike", KeyInfoBool, "false",
        N_("compute soundslike on demand rather than storing")} 
+    , {"large-offsets",  KeyInfoBool, "false",
+       N_("allow dictionaries larger than 4 GiB")}
     , {"partially-expand",  KeyInfoBool, "false",
        N_("partially expand affixes for better suggestions")}
+    , {"perfect-hash",  KeyInfoBool, "false",
+       N_("add a minimal perfect hash index to the word list")}
     , {"skip-invalid-words",  KeyInfoBool, "true",
        N_("skip invalid words")}
+    , {"soundslike-index",  KeyInfoBool, "false",
+       N_("add an index to speed up suggestions")}
     , {"validate-affixes", KeyInfoBool, "true",
        N_("check if affix flags are valid")}
     , {"validate-words", KeyInfoBool, "true",
        N_("check if words are valid")}
+    , {"word-frequency", KeyInfoBool, "false",
+       N_("read a frequency after each word and store it")}
     
     //
     // These options are specific to the "aspell" utility.  They are
@@ -33,6 +33,7 @@ namespace acommon {
   class Tokenizer;
   class Filter;
   class DocumentChecker;
+  class StringPairEnumeration;
 
   struct CheckInfo {
     const CheckInfo * next;
@@ -96,6 +97,10 @@ namespace acommon {
     // should be called only after this class is setup
     virtual void setup_tokenizer(Tokenizer *) = 0;
 
+    // returns a new speller sharing the dictionaries and language
+    // data with this one, use clone_speller instead
+    virtual PosibErr<Speller *> clone(bool share_word_lists) const = 0;
+
     ////////////////////////////////////////////////////////////////
     // 
     // Strings from this point on are expected to be in the 
@@ -104,8 +109,20 @@ namespace acommon {
 
     virtual PosibErr<bool> check(MutableString) = 0;
 
+    // checks n words in the external encoding, a size of -1 or null
+    // sizes means null terminated, returns the number correct
+    virtual PosibErr<int> check_batch(const char * * words, const int * sizes,
+                                      int n, int * results) = 0;
+
     // these functions return information about the last word checked
     virtual const CheckInfo * check_info() = 0;
+
+    // how often the check cache was used by the speller's own
+    // methods, see "check-cache-size"; checks made through a
+    // SpellerImpl::Context are counted by that context's cache_hits()
+    // and cache_misses() instead
+    virtual void check_cache_stats(unsigned long * hits,
+                                   unsigned long * misses) const = 0;
   
     virtual PosibErr<void> add_to_personal(MutableString) = 0;
     virtual PosibErr<void> add_to_session (MutableString) = 0;
@@ -126,10 +143,44 @@ namespace acommon {
     // return null on error
     // the word list returned by suggest is only valid until the next
     // call to suggest
+
+    // like suggest but gives up after usecs microseconds, unless
+    // usecs is 0 or less, returning the best suggestions found by then
+    virtual PosibErr<const WordList *> suggest_within(MutableString,
+                                                      int usecs) = 0;
+    // true if the last call to suggest, suggest_within or
+    // suggest_batch ran out of time
+    virtual bool suggest_timed_out() const = 0;
+
+    // suggest a step at a time: suggest_begin returns the suggestions
+    // found by the quick steps and each call to suggest_refine does
+    // one more step and returns the suggestions found so far, until
+    // suggest_done when they are the ones suggest would return
+    virtual PosibErr<const WordList *> suggest_begin(MutableString) = 0;
+    virtual PosibErr<const WordList *> suggest_refine() = 0;
+    virtual bool suggest_done() const = 0;
+
+    // finds the suggestions for n words in the external encoding at
+    // once, a size of -1 or null sizes means null terminated, returns n
+    virtual PosibErr<int> suggest_batch(const char * * words, 
+                                        const int * sizes, int n) = 0;
+    // the suggestions for word i of the last call to suggest_batch or
+    // null if there is no such word, valid until the next call to
+    // suggest_batch
+    virtual PosibErr<const WordList *> batch_suggestions(int i) = 0;
   
     virtual PosibErr<void> store_replacement(MutableString, 
 					     MutableString) = 0;
 
+    // reads the dictionaries into memory so that the first words
+    // checked do not have to wait for the disk
+    virtual PosibErr<void> warm() = 0;
+
+    // returns the file name of each dictionary paired with its size
+    // and how much of it is in memory, in bytes, as "<size> <resident>",
+    // leaving out those for which that is not known
+    virtual StringPairEnumeration * dict_memory_usage() const = 0;
+
     virtual ~Speller();
 
   };
@@ -142,6 +193,13 @@ namespace acommon {
 
   PosibErr<Speller *> new_speller(Config * c);
 
+  // Creates a new speller from an already set up one without reading
+  // any dictionaries.  If share_word_lists is true the personal,
+  // session and replacement word lists are shared with the original,
+  // otherwise the clone gets its own, set up as new_speller would.
+  PosibErr<Speller *> clone_speller(const Speller * orig, 
+                                    bool share_word_lists);
+
 }
 
 #endif
@@ -481,6 +481,17 @@ namespace acommon {
     return m.release();
   }
 
+  PosibErr<Speller *> clone_speller(const Speller * orig, 
+                                    bool share_word_lists) 
+  {
+    RET_ON_ERR_SET(orig->clone(share_word_lists), Speller *, s);
+    StackPtr<Speller> m(s);
+
+    RET_ON_ERR(reload_filters(m));
+
+    return m.release();
+  }
+
   void delete_speller(Speller * m) 
   {
     SpellerLtHandle h = ((Speller *)(m))->lt_handle();
@@ -825,18 +825,17 @@ bool AffixMgr::affix_check(const LookupInfo & linf, ParmString word,
   CasePattern cp = lang->LangImpl::case_pattern(word);
   ParmString pword = word;
   ParmString sword = word;
-  CharVector lower;
+  VARARRAY(char, lower, word.size() + 1);
   if (cp == FirstUpper) {
-    lower.append(word, word.size() + 1);
+    memcpy(lower, word, word.size() + 1);
     lower[0] = lang->to_lower(word[0]);
-    pword = ParmString(lower.data(), lower.size() - 1);
+    pword = ParmString(lower, word.size());
   } else if (cp == AllUpper) {
-    lower.resize(word.size() + 1);
     unsigned int i = 0;
     for (; i != word.size(); ++i)
       lower[i] = lang->to_lower(word[i]);
     lower[i] = '\0';
-    pword = ParmString(lower.data(), lower.size() - 1);
+    pword = ParmString(lower, word.size());
     sword = pword;
   }
 
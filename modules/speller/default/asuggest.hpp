@@ -21,6 +21,8 @@ namespace aspeller {
 
     bool try_one_edit_word, try_scan_0, try_scan_1, try_scan_2, try_ngram;
 
+    bool use_scan_index; // use soundslike_neighbors when available
+
     int ngram_threshold, ngram_keep;
 
     bool check_after_one_edit_word;
@@ -35,13 +37,18 @@ namespace aspeller {
     int span;
     int limit;
 
+    int freq_stop; // stop once this many common words are found, if > 0
+
+    unsigned scan_threads; // number of threads to scan a dictionary with
+
     String split_chars;
     bool camel_case;
 
     SuggestParms() {}
 
-    PosibErr<void> init(ParmString mode, SpellerImpl * sp);
-    PosibErr<void> init(ParmString mode, SpellerImpl * sp, Config *);
+    PosibErr<void> init(ParmString mode, const SpellerImpl * sp);
+    PosibErr<void> init(ParmString mode, const SpellerImpl * sp,
+                        const Config *);
   };
   
   Suggest * new_default_suggest(const Speller *, const SuggestParms &);
@@ -0,0 +1,75 @@
+#ifndef __aspeller_check_cache__
+#define __aspeller_check_cache__
+
+#include "check_list.hpp"
+#include "parm_string.hpp"
+#include "string.hpp"
+#include "vector.hpp"
+
+namespace aspeller {
+
+  using acommon::ParmString;
+  using acommon::String;
+  using acommon::Vector;
+
+  //
+  // A bounded cache of check results keyed on the word in the
+  // internal encoding.  It is direct mapped on the hash of the word,
+  // so a new entry simply replaces whatever was in its slot.  Besides
+  // the result the cache keeps the check info and, if it was
+  // collected, the guess info, so that check_info() is the same on a
+  // hit as on a miss.
+  //
+  // A cache belongs to a single SpellerImpl::Context and is thus
+  // never used by more than one thread at a time and needs no
+  // locking.  Entries are tagged with the generation of the speller
+  // they were made in, the speller changes its generation whenever
+  // its word lists or the options affecting check change.
+  //
+
+  class CheckCache
+  {
+  public:
+    CheckCache() : owner(0), capacity(0), shift(0), hits(0), misses(0) {}
+
+    // clears the cache and sets it up for use by the speller "o"
+    void reset(const void * o, unsigned size);
+
+    // on a hit sets "correct" and fills in "ci" and, if not null,
+    // "gi" as check would have, on a miss returns false
+    bool lookup(ParmString word, unsigned gen, bool & correct,
+                CheckInfo * ci, GuessInfo * gi);
+
+    void insert(ParmString word, unsigned gen, bool correct,
+                const CheckInfo * ci, const GuessInfo * gi);
+
+    const void *  owner;
+    unsigned      capacity;
+    unsigned      shift;
+    unsigned long hits;
+    unsigned long misses;
+
+  private:
+    struct Saved {
+      CheckInfo info;
+      int offset; // into the word or strs, -1 if word.str is kept
+    };
+    struct Entry {
+      String        word;
+      unsigned      generation;
+      bool          used;
+      bool          correct;
+      bool          have_guesses;
+      unsigned      num_check; // the rest of infos are guesses
+      Vector<Saved> infos;
+      String        strs;
+      Entry() : used(false) {}
+    };
+    Vector<Entry> entries;
+
+    Entry & slot(ParmString word);
+  };
+
+}
+
+#endif
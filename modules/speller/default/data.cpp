@@ -72,7 +72,8 @@ namespace aspeller {
       validate_words(true),
       affix_compressed(false), 
       invisible_soundslike(false), soundslike_root_only(false),
-      fast_scan(false), fast_lookup(false)
+      fast_scan(false), fast_lookup(false), transient_soundslike(false),
+      generation(0)
   {
     id_.reset(new Id(this));
   }
@@ -285,6 +286,32 @@ namespace aspeller {
     return 0;
   }
   
+  SoundslikeEnumeration * 
+  Dictionary::soundslike_neighbors(const char * const *, const char * const *,
+                                   int) const
+  {
+    return 0;
+  }
+
+  SoundslikeEnumeration * 
+  Dictionary::soundslike_part(unsigned, unsigned) const
+  {
+    return 0;
+  }
+
+  void Dictionary::warm() const
+  {
+  }
+
+  void Dictionary::prefetch(ParmString) const
+  {
+  }
+
+  bool Dictionary::memory_usage(size_t &, size_t &) const
+  {
+    return false;
+  }
+  
   PosibErr<void> Dictionary::add(ParmString w, ParmString s) 
   {
     return make_err(unimplemented_method, "add", class_name);
@@ -124,6 +124,13 @@ namespace aspeller {
                      // with an edit distance of 1 or 2
     bool fast_lookup; // can effectively find all words with a given soundslike
                       // when the SoundslikeWord is not given
+    bool transient_soundslike; // the soundslike strings returned by
+                               // soundslike_elements are only valid
+                               // until the next call to next()
+    unsigned long generation; // set by SpellerImpl, to a value no dictionary
+                              // has had before, whenever it changes the
+                              // words; 0 while they are still the ones
+                              // the dictionary was loaded with
     
     typedef WordEntryEnumeration        Enum;
     typedef const char *                Value;
@@ -149,6 +156,37 @@ namespace aspeller {
     // times in the list....
     virtual SoundslikeEnumeration * soundslike_elements() const;
 
+    // returns the soundslikes (or words if invisible_soundslike) which
+    // may be within max_dist edits of one of the soundslikes in
+    // [sls, sls_end), in the same order as soundslike_elements.  Other
+    // soundslikes may also be returned so the edit distance still
+    // needs to be checked.  Returns null if the dictionary does not
+    // have an index for this.
+    virtual SoundslikeEnumeration * soundslike_neighbors(const char * const * sls,
+                                                         const char * const * sls_end,
+                                                         int max_dist) const;
+
+    // returns the part'th of num_parts consecutive ranges of
+    // soundslike_elements so that the ranges can be scanned in
+    // parallel.  The parts together return the same elements in the
+    // same order.  Some parts may be empty.  Returns null if the
+    // dictionary can not be split.
+    virtual SoundslikeEnumeration * soundslike_part(unsigned part,
+                                                    unsigned num_parts) const;
+
+    // brings the data of the dictionary into memory so that the first
+    // lookups do not have to wait for it to be read from disk
+    virtual void warm() const;
+
+    // hints that word is about to be looked up so that the memory it
+    // will touch can be fetched in the meantime, the word is hashed
+    // again by the lookup so this is not free
+    virtual void prefetch(ParmString word) const;
+
+    // gets the size of the compiled data and how much of it is
+    // currently in memory, returns false if not known
+    virtual bool memory_usage(size_t & size, size_t & resident) const;
+
     virtual PosibErr<void> add(ParmString w, ParmString s);
     PosibErr<void> add(ParmString w);
 
@@ -205,6 +205,8 @@ namespace aspeller {
     to_clean_[0x10] = 0x10;
 
     clean_chars_   = get_clean_chars(*this);
+    // see clean_chars()
+    clean_chars_.ensure_null_end();
 
     //
     // determine which mapping to use
@@ -269,6 +271,7 @@ namespace aspeller {
       soundslike_.reset(pe.data);
     }
     soundslike_chars_ = soundslike_->soundslike_chars();
+    soundslike_chars_.ensure_null_end();
 
     have_soundslike_ = strcmp(soundslike_->name(), "none") != 0;
 
@@ -685,6 +688,7 @@ namespace aspeller {
     if (!config.have("norm-strict"))
       config.replace("norm-strict", "true");
     have_affix = lang->have_affix();
+    read_freq = config.retrieve_bool("word-frequency");
     validate_words = config.retrieve_bool("validate-words");
     validate_affixes = config.retrieve_bool("validate-affixes");
     clean_words = config.retrieve_bool("clean-words");
@@ -704,6 +708,7 @@ namespace aspeller {
     if (!config.have("norm-strict"))
       config.replace("norm-strict", "true");
     have_affix = false;
+    read_freq = false;
     validate_words = config.retrieve_bool("validate-words");
     clean_words = true;
     if (config.have("clean-words"))
@@ -736,6 +741,29 @@ namespace aspeller {
         str = iconv.buf.pbegin();
         str_end = iconv.buf.pend();
       }
+      val.freq = 0;
+      if (read_freq) {
+        // the frequency is an optional number at the end of the line
+        // separated from the word by whitespace
+        char * f = str_end;
+        while (f > str && asc_isdigit(f[-1])) --f;
+        if (f != str_end && f > str && asc_isspace(f[-1])) {
+          int freq = atoi(f);
+          if (str_end - f > 3 || freq > 255) {
+            PosibErrBase pe = make_err(invalid_word, MsgConv(lang)(str),
+                                       _("The frequency must be a number from 0 to 255."));
+            if (!skip_invalid_words) return pe;
+            if (log) log->printf(_("Warning: %s Skipping word.\n"), pe.get_err()->mesg);
+            else pe.ignore_err();
+            str = 0;
+            goto loop;
+          }
+          val.freq = freq;
+          while (f > str && asc_isspace(f[-1])) --f;
+          *f = '\0';
+          str_end = f;
+        }
+      }
       char * aff = str_end;
       char * aff_end = str_end;
       if (have_affix) {
@@ -295,7 +295,9 @@ namespace aspeller {
     }
 
 
-    const char * clean_chars() const {return clean_chars_.c_str();}
+    // null terminated by setup so that, unlike c_str(), the string is
+    // not written to and several threads may call it at once
+    const char * clean_chars() const {return clean_chars_.data();}
 
     //
     // Soundslike
@@ -322,7 +324,8 @@ namespace aspeller {
       else return soundslike_->to_soundslike(res,str,len);
     }
 
-    const char * soundslike_chars() const {return soundslike_chars_.c_str();}
+    // see clean_chars()
+    const char * soundslike_chars() const {return soundslike_chars_.data();}
 
     //
     // Affix compression methods
@@ -482,6 +485,7 @@ namespace aspeller {
     struct Value {
       SimpleString word;
       SimpleString aff;
+      int freq; // 0 unless read_freq is set, see init
     };
     WordListIterator(StringEnumeration * in,
                      const Language * lang,
@@ -499,6 +503,7 @@ namespace aspeller {
     PosibErr<bool> adv();
   private:
     bool have_affix;
+    bool read_freq;
     bool validate_words;
     bool validate_affixes;
     bool clean_words;
@@ -11,28 +11,66 @@
 // * jump table for editdist 2
 // * data block
 // * hash table
+// * optional sections
+
+// The hash table is either a table of u32int offsets into the data
+// block (rowl 1.10) or a table of 64 byte HashBucket's (rowl 1.11).
+// The latter stores a 16 bit fingerprint with each offset so that
+// most non-matching words are rejected without leaving the bucket.
+
+// In rowl 1.12 the offsets in the header, the section table, the
+// jump tables and the hash table are 64 bit so that the block can be
+// larger than 4 GiB.  The data block itself is the same.
+
+// In rowl 1.13 the soundslike strings are front coded: each one only
+// stores the characters that differ from the soundslike before it.
+// The first soundslike of each jump2 group is stored in full so
+// decoding can start at any jump table entry.  The words themselves
+// are stored as before so lookups are not affected.
+
+// In rowl 1.14 each word starts with an 8 bit frequency, from 0 to
+// 255, taken from the word list.  Otherwise it is the same as 1.10.
+// The frequency is left out in all other versions.
 
 // data block laid out as follows:
 //
 // Words:
-//   (<8 bit frequency><8 bit: flags><8 bit: offset to next word>
+//   ([<8 bit frequency>]<8 bit: flags><8 bit: offset to next word>
 //      <8 bit: word size><word><null>
 //      [<affix info><null>][<category info><null>])+
 // Words with soundslike:
 //   (<8 bit: offset to next item><8 bit: soundslike size><soundslike>
 //      <words with that soundlike>)+
+// Words with front coded soundslike:
+//   (<8 bit: shared prefix size><8 bit: offset to next item>
+//      <8 bit: suffix size><suffix><words with that soundlike>)+
 // Flags are mapped as follows:
 //   bits 0-3: word info
 //   bit    4: duplicate flag
-//   bit    5: <unused>
+//   bit    5: have frequency
 //   bit    6: have affix info
 //   bit    7: have compound info
 
+// The optional sections are located via a table of SectionHead's
+// stored in the header right after the names.  A reader that does
+// not know about a section simply ignores it, thus adding a new
+// section does not change the format version.
+
+// The lang_hash field of the header holds a HeadFingerprint: a
+// fingerprint of the hash functions used to build the tables and a
+// checksum of the header.  When the fingerprint matches the loader
+// does not need to look up a word to make sure the hash function is
+// compatible.  Files without it are checked the old way.  The rest
+// of the data is deliberately not checksummed, as that would mean
+// reading the whole file on every load; only the header is covered.
+
 #include <utility>
 using std::pair;
 
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 //#include <errno.h>
 
 #include "settings.h"
@@ -45,6 +83,7 @@ using std::pair;
 #include "file_util.hpp"
 #include "fstream.hpp"
 #include "language.hpp"
+#include "leditdist.hpp"
 #include "stack_ptr.hpp"
 #include "objstack.hpp"
 #include "vector.hpp"
@@ -56,6 +95,7 @@ using std::pair;
 
 #include "gettext.h"
 
+typedef uint64_t       u64int;
 typedef unsigned int   u32int;
 static const u32int u32int_max = (u32int)-1;
 typedef unsigned short u16int;
@@ -67,6 +107,11 @@ typedef u32int hash_int_t;
 typedef size_t hash_int_t;
 #endif
 
+#ifdef USE_POSIX_MUTEX
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
 #ifdef HAVE_MMAP 
 
 // POSIX headers
@@ -80,42 +125,118 @@ typedef size_t hash_int_t;
 #define MAP_FAILED (-1)
 #endif
 
+#ifdef __GNUC__
+#  define PREFETCH(p) __builtin_prefetch(p)
+#else
+#  define PREFETCH(p)
+#endif
+
+#if defined(HAVE_MMAP) && defined(HAVE_MINCORE)
+
+// sets res to the number of bytes of the mapped block which are in
+// memory, returns false if that is not known
+static inline bool resident_size(char * block, size_t size, size_t & res)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t pages = (size + page - 1) / page;
+  Vector<unsigned char> vec(pages);
+  if (mincore(block, size, vec.data()) != 0) return false;
+  res = 0;
+  for (size_t i = 0; i != pages; ++i)
+    if (vec[i] & 1) res += page;
+  if (res > size) res = size;
+  return true;
+}
+
+#else
+
+static inline bool resident_size(char *, size_t, size_t &)
+{
+  return false;
+}
+
+#endif
+
 #ifdef HAVE_MMAP
 
-static inline char * mmap_open(unsigned int block_size, 
+static inline char * mmap_open(size_t block_size, 
 			       FStream & f, 
-			       unsigned int offset) 
+			       off_t offset,
+                               bool populate = false) 
 {
   f.flush();
   int fd = f.file_no();
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  if (populate) flags |= MAP_POPULATE;
+#endif
   return static_cast<char *>
-    (mmap(NULL, block_size, PROT_READ, MAP_SHARED, fd, offset));
+    (mmap(NULL, block_size, PROT_READ, flags, fd, offset));
 }
 
-static inline void mmap_free(char * block, unsigned int size) 
+static inline void mmap_free(char * block, size_t size) 
 {
   munmap(block, size);
 }
 
+static inline void mmap_advise(char * block, size_t size, 
+                               bool willneed, bool hugepage)
+{
+#ifdef MADV_WILLNEED
+  if (willneed) madvise(block, size, MADV_WILLNEED);
+#endif
+#ifdef MADV_HUGEPAGE
+  if (hugepage) madvise(block, size, MADV_HUGEPAGE);
+#endif
+}
+
+static inline bool lock_block(char * block, size_t size)
+{
+  return mlock(block, size) == 0;
+}
+
+static inline void unlock_block(char * block, size_t size)
+{
+  munlock(block, size);
+}
+
+static inline size_t page_size()
+{
+  return sysconf(_SC_PAGESIZE);
+}
+
 #else
 
-static inline char * mmap_open(unsigned int, 
+static inline char * mmap_open(size_t, 
 			       FStream & f, 
-			       unsigned int) 
+			       long,
+                               bool = false) 
 {
   return reinterpret_cast<char *>(MAP_FAILED);
 }
 
-static inline void mmap_free(char *, unsigned int) 
+static inline void mmap_free(char *, size_t) 
 {
   abort();
 }
 
+static inline void mmap_advise(char *, size_t, bool, bool) {}
+
+static inline bool lock_block(char *, size_t) {return false;}
+
+static inline void unlock_block(char *, size_t) {}
+
+static inline size_t page_size() {return 4096;}
+
 #endif
 
 static byte HAVE_AFFIX_FLAG = 1 << 7;
 static byte HAVE_CATEGORY_FLAG = 1 << 6;
 
+static byte HAVE_FREQUENCY_FLAG = 1 << 5;
+// this flag is set on every word of a rowl 1.14 dictionary so that
+// the frequency can be found without knowing the version
+
 static byte DUPLICATE_FLAG = 1 << 4;
 // this flag is set when there is is more than one word for a
 // particulear "clean" word such as "jello" "Jello".  It is set on all
@@ -145,9 +266,23 @@ static inline const char * get_next(const char * d) {
   return d + *reinterpret_cast<const byte *>(d - NEXT_O);
 }
 
-static inline const char * get_sl_words_begin(const char * d) {
-  return d + *reinterpret_cast<const byte *>(d - WORD_SIZE_O) + 4;
-  // FIXME: This isn't right when frequency info is stored in the table
+// the number of leading characters a front coded soundslike shares
+// with the one before it
+static inline int get_sl_shared(const char * d) {
+  return *reinterpret_cast<const byte *>(d - FLAGS_O);
+}
+
+static inline int get_frequency(const char * d) {
+  if (get_flags(d) & HAVE_FREQUENCY_FLAG)
+    return *reinterpret_cast<const byte *>(d - FREQUENCY_INFO_O);
+  else
+    return 0;
+}
+
+// word_head is the size of the header before each word, 4 when the
+// frequency is stored and 3 otherwise
+static inline const char * get_sl_words_begin(const char * d, int word_head) {
+  return d + *reinterpret_cast<const byte *>(d - WORD_SIZE_O) + 1 + word_head;
 }
 
 // get_next might go past the end so don't JUST compare
@@ -183,54 +318,420 @@ namespace {
   using namespace aspeller;
 
   /////////////////////////////////////////////////////////////////////
-  // 
+  //
+  //  Optional Sections
+  //
+
+  struct SectionHead {
+    u32int id;
+    u32int version;
+    u32int offset; // from the beginning of the block
+    u32int size;
+  };
+
+  // used by rowl 1.12, and in memory for all versions
+  struct LargeSectionHead {
+    u32int id;
+    u32int version;
+    u64int offset; // from the beginning of the block
+    u64int size;
+  };
+
+  enum SectionId {PERFECT_HASH_SECTION = 1, BLOOM_FILTER_SECTION = 2,
+                  SOUNDSLIKE_INDEX_SECTION = 3, DELETION_INDEX_SECTION = 4};
+
+  static inline u64int mix64(u64int h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // Hashes the clean form of a word.  Unlike InsensitiveHash the
+  // result does not depend on the size of size_t so it is safe to
+  // store values derived from it in the compiled dictionary.
+  static inline u64int clean_hash(const Language * lang, const char * s,
+                                  u32int seed)
+  {
+    u64int h = 0xcbf29ce484222325ULL ^ seed;
+    for (; *s; ++s) {
+      unsigned char c = lang->to_clean(*s);
+      if (c) {h ^= c; h *= 0x100000001b3ULL;}
+    }
+    return mix64(h);
+  }
+
+  //
+  // Stored in the lang_hash field of the header.  hash_fun depends on
+  // the size of hash_int_t and the language's clean table, clean only
+  // on the clean table.
+  //
+  struct HeadFingerprint {
+    char   magic[4]; // "fp1"
+    u32int hash_fun;
+    u32int clean;
+    u32int head_sum; // checksum of the header with this field zero
+  };
+
+  static const char fingerprint_magic[4] = {'f', 'p', '1', '\0'};
+
+  static void fingerprint(const Language * lang, HeadFingerprint & fp)
+  {
+    // every non-null byte so that all of the clean table is covered
+    char probe[256];
+    for (int i = 0; i != 255; ++i) probe[i] = (char)(i + 1);
+    probe[255] = '\0';
+    memcpy(fp.magic, fingerprint_magic, sizeof(fp.magic));
+    u64int h = InsensitiveHash<hash_int_t>(lang)(probe);
+    fp.hash_fun = (u32int)(h ^ (h >> 32));
+    fp.clean = (u32int)clean_hash(lang, probe, 0);
+    fp.head_sum = 0;
+  }
+
+  static u32int head_checksum(const char * d, size_t size)
+  {
+    u32int h = 2166136261U;
+    for (size_t i = 0; i != size; ++i) {
+      h ^= (unsigned char)d[i];
+      h *= 16777619U;
+    }
+    return h;
+  }
+
+  //
+  // Minimal perfect hash using the "hash and displace" method.  Keys
+  // are divided into buckets and each bucket stores a displacement
+  // which maps all the keys in the bucket to distinct slots.  Buckets
+  // with a single key store the slot directly.  A lookup is one hash
+  // and, since each slot holds exactly one word, at most one compare.
+  //
+  // Section layout:
+  //   <32 bit seed><32 bit bucket count><32 bit slot count><32 bit unused>
+  //   <32 bit displacement>[bucket count]
+  //   <32 bit word offset>[slot count]
+  //
+
+  static const u32int PH_DIRECT = 1u << 31;
+
+  struct PerfectHash {
+    u32int seed;
+    u32int bucket_count;
+    u32int slot_count;
+    const u32int * disp;
+    const u32int * slots;
+    PerfectHash() : seed(0), bucket_count(0), slot_count(0), disp(0), slots(0) {}
+    u32int bucket(u64int h) const {
+      return (u32int)(((h >> 32) * bucket_count) >> 32);
+    }
+    static u32int slot(u64int h, u32int d, u32int slot_count) {
+      if (d & PH_DIRECT) return d & ~PH_DIRECT;
+      return (u32int)(mix64(h + d * 0x9e3779b97f4a7c15ULL) % slot_count);
+    }
+    // returns the offset of the only word that may match
+    u32int find(u64int h) const {
+      return slots[slot(h, disp[bucket(h)], slot_count)];
+    }
+  };
+
+  //
+  // Blocked Bloom filter over the clean form of each word.  All the
+  // bits for a key are in the same 64 byte block so a test touches a
+  // single cache line.  Since the affix code looks up the possible
+  // roots of a word, it also rejects most impossible roots without
+  // touching the word block.
+  //
+  // Section layout:
+  //   <32 bit seed><32 bit block count><32 bit unused><32 bit unused>
+  //   <512 bit block>[block count]
+  //
+
+  static const unsigned BLOOM_BITS_PER_KEY = 10;
+  static const unsigned BLOOM_K = 7;
+
+  struct BloomFilter {
+    u32int seed;
+    u32int block_count;
+    const u64int * blocks;
+    BloomFilter() : seed(0), block_count(0), blocks(0) {}
+    static u32int block(u32int block_count, u64int h) {
+      return 8 * (u32int)(((h >> 32) * block_count) >> 32);
+    }
+    static void set(u64int * blocks, u32int block_count, u64int h) {
+      u64int * b = blocks + block(block_count, h);
+      u64int g = mix64(h ^ 0x2545f4914f6cdd1dULL);
+      for (unsigned i = 0; i != BLOOM_K; ++i, g >>= 9)
+        b[(g >> 6) & 7] |= (u64int)1 << (g & 63);
+    }
+    bool maybe_have(u64int h) const {
+      const u64int * b = blocks + block(block_count, h);
+      u64int g = mix64(h ^ 0x2545f4914f6cdd1dULL);
+      for (unsigned i = 0; i != BLOOM_K; ++i, g >>= 9)
+        if (!(b[(g >> 6) & 7] & ((u64int)1 << (g & 63)))) return false;
+      return true;
+    }
+  };
+
+  //
+  // Index over the stored soundslike strings.  The strings are the
+  // leaves of a trie in depth first order, so for each one it is
+  // enough to store how deep it branches off from the previous one
+  // (the length of the common prefix, plus one if the strings are
+  // equal) and where the next leaf with a smaller depth is.  This
+  // allows SoundslikeElements to skip all strings with a common
+  // prefix of any length in a few steps, rather than only those
+  // sharing up to six characters.
+  //
+  // Section layout:
+  //   <32 bit node count><32 bit unused><32 bit unused><32 bit unused>
+  //   <SoundslikeNode>[node count]
+  //
+
+  struct SoundslikeNode {
+    u32int offset; // of the soundslike in the word block
+    u32int next;   // index of the next node with a smaller depth
+    byte   depth;
+    byte   unused[3];
+  };
+
+  struct SoundslikeIndex {
+    u32int size;
+    const SoundslikeNode * nodes;
+    SoundslikeIndex() : size(0), nodes(0) {}
+    // returns the index of the first node, starting at i, which does
+    // not share the first prefix_len characters with the node before i
+    u32int skip(u32int i, u32int prefix_len) const {
+      while (i < size && nodes[i].depth >= prefix_len)
+        i = nodes[i].next;
+      return i;
+    }
+    // returns the index of the node for the soundslike at offset
+    u32int find(u32int offset) const {
+      u32int b = 0, e = size;
+      while (b < e) {
+        u32int m = b + (e - b)/2;
+        if (nodes[m].offset < offset) b = m + 1;
+        else e = m;
+      }
+      return b;
+    }
+  };
+
+  //
+  // Symmetric deletion index over the soundslike strings (or the
+  // words when the soundslike is invisible).  Every string formed by
+  // deleting up to max_deletions characters from a soundslike is
+  // hashed and the soundslike is added to the bucket for that hash.
+  // If two strings are within N edits of each other, counting a swap
+  // as one edit, then they have a deletion of at most N characters
+  // from each in common (a swap is undone by deleting one of the two
+  // characters from each string), thus all soundslikes within N
+  // edits of a misspelled word can be found by looking up its own
+  // deletions.  The buckets may contain other soundslikes as only the
+  // hash is stored.
+  //
+  // Section layout:
+  //   <32 bit max deletions><32 bit bucket count><32 bit entry count>
+  //     <32 bit unused>
+  //   <32 bit start of bucket>[bucket count + 1]
+  //   <32 bit offset in word block>[entry count]
+  //
+
+  static const unsigned DELETION_INDEX_MAX_DELETIONS = 2;
+
+  // hash of s with the characters at positions i and j removed
+  static inline u64int deletion_hash(const char * s, unsigned size,
+                                     unsigned i, unsigned j)
+  {
+    u64int h = 0xcbf29ce484222325ULL;
+    for (unsigned k = 0; k != size; ++k) {
+      if (k == i || k == j) continue;
+      h ^= (unsigned char)s[k]; 
+      h *= 0x100000001b3ULL;
+    }
+    return mix64(h);
+  }
+
+  // calls f.add(h) with the hash of every string formed by deleting
+  // at most max_deletions characters from s.  Deleting any character
+  // of a run gives the same string so only the first one is deleted.
+  template <class F>
+  static void deletion_hashes(const char * s, unsigned size,
+                              unsigned max_deletions, F & f)
+  {
+    f.add(deletion_hash(s, size, size, size));
+    if (max_deletions < 1) return;
+    for (unsigned i = 0; i != size; ++i) {
+      if (i != 0 && s[i] == s[i-1]) continue;
+      f.add(deletion_hash(s, size, i, size));
+      if (max_deletions < 2) continue;
+      for (unsigned j = i + 1; j != size; ++j) {
+        if (j != i + 1 && s[j] == s[j-1]) continue;
+        f.add(deletion_hash(s, size, i, j));
+      }
+    }
+  }
+
+  struct DeletionIndex {
+    u32int max_deletions;
+    u32int bucket_count;
+    const u32int * buckets;
+    const u32int * entries;
+    DeletionIndex() 
+      : max_deletions(0), bucket_count(0), buckets(0), entries(0) {}
+    static u32int bucket(u32int bucket_count, u64int h) {
+      return (u32int)(((h >> 32) * bucket_count) >> 32);
+    }
+  };
+
+  /////////////////////////////////////////////////////////////////////
+  //
+  //  Bucketed Hash Table
+  //
+
+  //
+  // Each bucket is one cache line holding up to BUCKET_ENTRIES
+  // words.  The bucket is selected with the high bits of clean_hash
+  // and the fingerprint is the low 16 bits.  When a bucket is full
+  // the words spill into the next one and the overflow flag is set.
+  //
+
+  static const unsigned BUCKET_ENTRIES = 10;
+
+  struct HashBucket {
+    u16int fingerprint[BUCKET_ENTRIES];
+    byte   size;
+    byte   overflow;
+    u16int unused;
+    u32int offset[BUCKET_ENTRIES];
+  };
+
+  struct BucketHash {
+    u32int bucket_count;
+    const HashBucket * buckets;
+    BucketHash() : bucket_count(0), buckets(0) {}
+    static u32int bucket(u32int bucket_count, u64int h) {
+      return (u32int)(((h >> 32) * bucket_count) >> 32);
+    }
+    static u16int fingerprint(u64int h) {return (u16int)h;}
+  };
+
+  /////////////////////////////////////////////////////////////////////
+  //
   //  ReadOnlyDict
   //
-    
+
   struct Jump
   {
     char   sl[4];
     u32int loc;
     Jump() {memset(this, 0, sizeof(Jump));}
   };
+
+  // used by rowl 1.12
+  struct LargeJump
+  {
+    char   sl[4];
+    u32int reserved;
+    u64int loc;
+    LargeJump() {memset(this, 0, sizeof(LargeJump));}
+  };
   
   class ReadOnlyDict : public Dictionary
   {
 
   public: //but don't use
 
+    template <class Offset>
     struct WordLookupParms {
       const char * block_begin;
       WordLookupParms() {}
-      typedef BlockVector<const u32int> Vector;
-      typedef u32int                    Value;
+      typedef BlockVector<const Offset> Vector;
+      typedef Offset                    Value;
       typedef const char *              Key;
       static const bool is_multi = false;
       Key key(Value v) const {return block_begin + v;}
       InsensitiveHash<hash_int_t> hash;
       InsensitiveEqual equal;
-      bool is_nonexistent(Value v) const {return v == u32int_max;}
+      bool is_nonexistent(Value v) const {return v == (Offset)-1;}
       void make_nonexistent(const Value & v) const {abort();}
     };
-    typedef VectorHashTable<WordLookupParms> WordLookup;
+    typedef VectorHashTable<WordLookupParms<u32int> > WordLookup;
+    typedef VectorHashTable<WordLookupParms<u64int> > LargeWordLookup;
 
   public: // but don't use
       
     char *           block;
-    u32int           block_size;
+    size_t           block_size;
     char *           mmaped_block;
-    u32int           mmaped_size;
+    size_t           mmaped_size;
+    bool             locked;
+    bool             large; // rowl 1.12
+    bool             front_coded; // rowl 1.13
+    int              word_head; // size of the word header, 4 in rowl 1.14
     const Jump * jump1;
     const Jump * jump2;
+    const LargeJump * large_jump1;
+    const LargeJump * large_jump2;
     WordLookup       word_lookup;
+    LargeWordLookup  large_word_lookup;
+    PerfectHash      perfect_hash;
+    BloomFilter      bloom_filter;
+    BucketHash       bucket_hash;
+    SoundslikeIndex  soundslike_index;
+    DeletionIndex    deletion_index;
     const char *     word_block;
     const char *     first_word;
+
+    // returns the first word with the same clean form or null
+    const char * find(const char * word) const {
+      u64int h = 0;
+      if (bloom_filter.blocks) {
+        h = clean_hash(lang(), word, bloom_filter.seed);
+        if (!bloom_filter.maybe_have(h)) return 0;
+      }
+      if (perfect_hash.slots) {
+        // an empty word list has no slots to find
+        if (perfect_hash.slot_count == 0) return 0;
+        if (!bloom_filter.blocks || bloom_filter.seed != perfect_hash.seed)
+          h = clean_hash(lang(), word, perfect_hash.seed);
+        const char * w = word_block + perfect_hash.find(h);
+        return word_lookup.parms().equal(word, w) ? w : 0;
+      }
+      if (bucket_hash.buckets) {
+        // the bucket hash always uses a seed of 0
+        if (!bloom_filter.blocks || bloom_filter.seed != 0)
+          h = clean_hash(lang(), word, 0);
+        u16int fp = BucketHash::fingerprint(h);
+        u32int b = BucketHash::bucket(bucket_hash.bucket_count, h);
+        for (;;) {
+          const HashBucket & bucket = bucket_hash.buckets[b];
+          for (unsigned i = 0; i != bucket.size; ++i) {
+            if (bucket.fingerprint[i] != fp) continue;
+            const char * w = word_block + bucket.offset[i];
+            if (word_lookup.parms().equal(word, w)) return w;
+          }
+          if (!bucket.overflow) return 0;
+          if (++b == bucket_hash.bucket_count) b = 0;
+        }
+      }
+      if (large) {
+        LargeWordLookup::const_iterator i = large_word_lookup.find(word);
+        if (i == large_word_lookup.end()) return 0;
+        return word_block + *i;
+      }
+      WordLookup::const_iterator i = word_lookup.find(word);
+      if (i == word_lookup.end()) return 0;
+      return word_block + *i;
+    }
     
     ReadOnlyDict(const ReadOnlyDict&);
     ReadOnlyDict& operator= (const ReadOnlyDict&);
 
     struct Elements;
-    struct SoundslikeElements;
+    template <class J> struct SoundslikeElements;
+    struct NeighborElements;
 
   public:
     WordEntryEnumeration * detailed_elements() const;
@@ -241,14 +742,20 @@ namespace {
       : Dictionary(basic_dict, "ReadOnlyDict")
     {
       block = 0;
+      locked = false;
+      large = false;
+      front_coded = false;
+      word_head = 3;
     }
 
     ~ReadOnlyDict() {
       if (block != 0) {
-	if (mmaped_block)
+	if (mmaped_block) {
 	  mmap_free(mmaped_block, mmaped_size);
-	else
+	} else {
+          if (locked) unlock_block(block, block_size);
 	  free(block);
+        }
       }
     }
     
@@ -264,6 +771,19 @@ namespace {
     bool soundslike_lookup(ParmString, WordEntry &) const;
     
     SoundslikeEnumeration * soundslike_elements() const;
+    SoundslikeEnumeration * soundslike_neighbors(const char * const * sls, 
+                                                 const char * const * sls_end,
+                                                 int max_dist) const;
+    SoundslikeEnumeration * soundslike_part(unsigned part,
+                                            unsigned num_parts) const;
+    template <class J>
+    SoundslikeEnumeration * soundslike_part(const J * j1, const J * j2,
+                                            unsigned part,
+                                            unsigned num_parts) const;
+
+    void warm() const;
+    void prefetch(ParmString) const;
+    bool memory_usage(size_t & size, size_t & resident) const;
 
   };
 
@@ -273,6 +793,7 @@ namespace {
     o.aff  = get_affix(w);
     o.word_size = get_word_size(w);
     o.word_info = get_flags(w) & WORD_INFO_MASK;
+    o.frequency = get_frequency(w);
   }
     
   //
@@ -282,11 +803,11 @@ namespace {
   struct ReadOnlyDict::Elements : public WordEntryEnumeration 
   {
     const char * w;
+    int skip; // to get from the end of a group to the next word
     WordEntry wi;
-    Elements(const char * w0) : w(w0) {wi.what = WordEntry::Word;}
+    Elements(const char * w0, int s) : w(w0), skip(s) {wi.what = WordEntry::Word;}
     WordEntry * next() {
-      if (get_offset(w) == 0) w += 2; // FIXME: This needs to be 3
-                                      //        when freq info is used
+      if (get_offset(w) == 0) w += skip;
       if (get_offset(w) == 0) return 0;
       convert(w, wi);
       w = get_next(w);
@@ -299,15 +820,14 @@ namespace {
   };
 
   WordEntryEnumeration * ReadOnlyDict::detailed_elements() const {
-    return new Elements(first_word);
+    return new Elements(first_word, word_head - 1);
   }
 
   void ReadOnlyDict::low_level_dump() const {
     bool next_dup = false;
     const char * w = first_word;
     for (;;) {
-      if (get_offset(w) == 0) w += 2; // FIXME: This needs to be 3
-                                      //        when freq info is used
+      if (get_offset(w) == 0) w += word_head - 1;
       if (get_offset(w) == 0) break;
       
       const char * aff = get_affix(w);
@@ -319,14 +839,15 @@ namespace {
       printf("%s", w);
       if (flags & HAVE_AFFIX_FLAG) printf("/%s", aff);
       if (word_info) printf(" [WI: %d]", word_info);
+      if (flags & HAVE_FREQUENCY_FLAG) printf(" [F: %d]", get_frequency(w));
       //if (flags & DUPLICATE_FLAG) printf(" [NEXT DUP]");
       const char * p = w;
-      WordLookup::const_iterator i = word_lookup.find(w);
+      const char * f = find(w);
       if (!next_dup) {
-        if (i == word_lookup.end())
+        if (!f)
           printf(" <BAD HASH>");
-        else if (word_block + *i != w) {
-          printf(" <BAD HASH, got %s>", word_block + *i);
+        else if (f != w) {
+          printf(" <BAD HASH, got %s>", f);
         }
         else 
           printf(" <hash ok>");
@@ -342,8 +863,7 @@ namespace {
   PosibErr<void> ReadOnlyDict::check_hash_fun() const {
     const char * w = first_word;
     for (;;) {
-      if (get_offset(w) == 0) w += 2; // FIXME: This needs to be 3
-                                      //        when freq info is used
+      if (get_offset(w) == 0) w += word_head - 1;
       if (get_offset(w) == 0) break;
       if (get_word_size(w) >= 12) {
         const char * p = w;
@@ -356,8 +876,7 @@ namespace {
           ++p;
         }
       clean_size_ok:
-        WordLookup::const_iterator i = word_lookup.find(w);
-        if (i == word_lookup.end() || word_block + *i != w)
+        if (find(w) != w)
           return make_err(bad_file_format, file_name(), 
                           _("Incompatible hash function."));
         else
@@ -380,6 +899,14 @@ namespace {
   }
 
   static const char * const cur_check_word = "aspell default speller rowl 1.10";
+  // same as 1.10 except that the hash table is made of HashBucket's
+  static const char * const bucket_check_word = "aspell default speller rowl 1.11";
+  // same as 1.10 except that the offsets are 64 bit
+  static const char * const large_check_word = "aspell default speller rowl 1.12";
+  // same as 1.10 except that the soundslike strings are front coded
+  static const char * const front_check_word = "aspell default speller rowl 1.13";
+  // same as 1.10 except that each word has a frequency
+  static const char * const freq_check_word = "aspell default speller rowl 1.14";
 
   struct DataHead {
     // all sizes except the last four must to divisible by:
@@ -411,8 +938,96 @@ namespace {
     byte soundslike_root_only;
     byte compound_info; //
     byte freq_info;
+    byte section_count; // SectionHead's stored after the names
+  };
+
+  // The header used by rowl 1.12, it is also used in memory for all
+  // versions
+  struct LargeDataHead {
+    static const unsigned int align = 16;
+    char check_word[64];
+    u32int endian_check; // = 12345678
+    char lang_hash[16];
+
+    u32int head_size;
+    u64int block_size;
+    u64int jump1_offset;
+    u64int jump2_offset;
+    u64int word_offset;
+    u64int hash_offset;
+
+    u64int word_count;
+    u64int word_buckets;
+    u64int soundslike_count;
+
+    u32int dict_name_size;
+    u32int lang_name_size;
+    u32int soundslike_name_size;
+    u32int soundslike_version_size;
+
+    u64int first_word_offset; // from word block
+
+    byte affix_info; // 0 = none, 1 = partially expanded, 2 = full
+    byte invisible_soundslike;
+    byte soundslike_root_only;
+    byte compound_info; //
+    byte freq_info;
+    byte section_count; // LargeSectionHead's stored after the names
   };
 
+  // converts between DataHead and LargeDataHead, when converting to a
+  // DataHead the caller must make sure the offsets fit
+  template <class From, class To>
+  static void convert_head(const From & f, To & t)
+  {
+    memcpy(t.check_word, f.check_word, sizeof(t.check_word));
+    t.endian_check = f.endian_check;
+    memcpy(t.lang_hash, f.lang_hash, sizeof(t.lang_hash));
+    t.head_size = f.head_size;
+    t.block_size = f.block_size;
+    t.jump1_offset = f.jump1_offset;
+    t.jump2_offset = f.jump2_offset;
+    t.word_offset = f.word_offset;
+    t.hash_offset = f.hash_offset;
+    t.word_count = f.word_count;
+    t.word_buckets = f.word_buckets;
+    t.soundslike_count = f.soundslike_count;
+    t.dict_name_size = f.dict_name_size;
+    t.lang_name_size = f.lang_name_size;
+    t.soundslike_name_size = f.soundslike_name_size;
+    t.soundslike_version_size = f.soundslike_version_size;
+    t.first_word_offset = f.first_word_offset;
+    t.affix_info = f.affix_info;
+    t.invisible_soundslike = f.invisible_soundslike;
+    t.soundslike_root_only = f.soundslike_root_only;
+    t.compound_info = f.compound_info;
+    t.freq_info = f.freq_info;
+    t.section_count = f.section_count;
+  }
+
+  // FStream::read and write only take an unsigned int size
+  static const u64int MAX_IO_CHUNK = 1 << 30;
+
+  static bool read_block(FStream & f, char * d, u64int size)
+  {
+    while (size > MAX_IO_CHUNK) {
+      if (!f.read(d, MAX_IO_CHUNK)) return false;
+      d += MAX_IO_CHUNK;
+      size -= MAX_IO_CHUNK;
+    }
+    return f.read(d, size);
+  }
+
+  static void write_block(FStream & f, const char * d, u64int size)
+  {
+    while (size > MAX_IO_CHUNK) {
+      f.write(d, MAX_IO_CHUNK);
+      d += MAX_IO_CHUNK;
+      size -= MAX_IO_CHUNK;
+    }
+    f.write(d, size);
+  }
+
   PosibErr<void> ReadOnlyDict::load(ParmString f0, Config & config, 
                                     DictList *, SpellerImpl *)
   {
@@ -422,9 +1037,19 @@ namespace {
     FStream f;
     RET_ON_ERR(f.open(fn, "rb"));
 
-    DataHead data_head;
+    LargeDataHead data_head;
+    memset(&data_head, 0, sizeof(data_head));
 
-    f.read(&data_head, sizeof(DataHead));
+    f.read(data_head.check_word, sizeof(data_head.check_word));
+    f.seek(0);
+    large = strcmp(data_head.check_word, large_check_word) == 0;
+    if (large) {
+      f.read(&data_head, sizeof(LargeDataHead));
+    } else {
+      DataHead small_head;
+      f.read(&small_head, sizeof(DataHead));
+      convert_head(small_head, data_head);
+    }
 
 #if 0
     COUT << "Head Size: " << data_head.head_size << "\n";
@@ -433,12 +1058,37 @@ namespace {
     COUT << "Total Block Size: " << data_head.total_block_size << "\n";
 #endif
 
-    if (strcmp(data_head.check_word, cur_check_word) != 0)
+    bool bucketed = strcmp(data_head.check_word, bucket_check_word) == 0;
+    front_coded = strcmp(data_head.check_word, front_check_word) == 0;
+    bool have_freq = strcmp(data_head.check_word, freq_check_word) == 0;
+    if (!bucketed && !large && !front_coded && !have_freq
+        && strcmp(data_head.check_word, cur_check_word) != 0)
+      return make_err(bad_file_format, fn);
+    if (have_freq != (data_head.freq_info != 0))
       return make_err(bad_file_format, fn);
+    word_head = have_freq ? 4 : 3;
 
     if (data_head.endian_check != 12345678)
       return make_err(bad_file_format, fn, _("Wrong endian order."));
 
+    HeadFingerprint fp;
+    memcpy(&fp, data_head.lang_hash, sizeof(fp));
+    bool have_fp = memcmp(fp.magic, fingerprint_magic, sizeof(fp.magic)) == 0;
+    if (have_fp) {
+      if (data_head.head_size < sizeof(DataHead))
+        return make_err(bad_file_format, fn);
+      CharVector head;
+      head.resize(data_head.head_size);
+      f.seek(0);
+      if (!f.read(head.data(), head.size()))
+        return make_err(bad_file_format, fn);
+      memset(head.data() + offsetof(DataHead, lang_hash) 
+             + offsetof(HeadFingerprint, head_sum), 0, sizeof(fp.head_sum));
+      if (head_checksum(head.data(), head.size()) != fp.head_sum)
+        return make_err(bad_file_format, fn, _("The header is corrupt."));
+      f.seek(large ? sizeof(LargeDataHead) : sizeof(DataHead));
+    }
+
     CharVector word;
 
     word.resize(data_head.dict_name_size);
@@ -469,30 +1119,73 @@ namespace {
         return make_err(bad_file_format, fn, _("Wrong soundslike version."));
     }
 
+    Vector<LargeSectionHead> sections(data_head.section_count);
+    if (data_head.section_count != 0) {
+      f.seek((large ? sizeof(LargeDataHead) : sizeof(DataHead))
+             + data_head.dict_name_size + data_head.lang_name_size
+             + data_head.soundslike_name_size 
+             + data_head.soundslike_version_size);
+      if (large) {
+        f.read(sections.data(), sections.size() * sizeof(LargeSectionHead));
+      } else {
+        Vector<SectionHead> small_sections(data_head.section_count);
+        f.read(small_sections.data(), 
+               small_sections.size() * sizeof(SectionHead));
+        for (unsigned i = 0; i != sections.size(); ++i) {
+          sections[i].id      = small_sections[i].id;
+          sections[i].version = small_sections[i].version;
+          sections[i].offset  = small_sections[i].offset;
+          sections[i].size    = small_sections[i].size;
+        }
+      }
+    }
+
     invisible_soundslike = data_head.invisible_soundslike;
     soundslike_root_only = data_head.soundslike_root_only;
 
+    if (front_coded && invisible_soundslike)
+      return make_err(bad_file_format, fn);
+    transient_soundslike = front_coded;
+
     affix_compressed = data_head.affix_info;
 
+    if (data_head.block_size + data_head.head_size > (size_t)-1)
+      return make_err(bad_file_format, fn, 
+                      _("The dictionary is too large for this platform."));
+
     block_size = data_head.block_size;
     int offset = data_head.head_size;
-    mmaped_block = mmap_open(block_size + offset, f, 0);
+    mmaped_block = mmap_open(block_size + offset, f, 0, 
+                             config.retrieve_bool("dict-populate"));
     if( mmaped_block != (char *)MAP_FAILED) {
       block = mmaped_block + offset;
       mmaped_size = block_size + offset;
+      mmap_advise(mmaped_block, mmaped_size, 
+                  config.retrieve_bool("dict-willneed"),
+                  config.retrieve_bool("dict-hugepage"));
     } else {
       mmaped_block = 0;
       block = (char *)malloc(block_size);
       f.seek(data_head.head_size);
-      f.read(block, block_size);
+      read_block(f, block, block_size);
     }
-
+    // failing to lock the block, for example because of
+    // RLIMIT_MEMLOCK, is not treated as an error
+    if (config.retrieve_bool("dict-mlock"))
+      locked = mmaped_block ? lock_block(mmaped_block, mmaped_size) 
+                            : lock_block(block, block_size);
+
+    jump1 = jump2 = 0;
+    large_jump1 = large_jump2 = 0;
     if (data_head.jump2_offset) {
       fast_scan = true;
-      jump1 = reinterpret_cast<const Jump *>(block + data_head.jump1_offset);
-      jump2 = reinterpret_cast<const Jump *>(block + data_head.jump2_offset);
-    } else {
-      jump1 = jump2 = 0;
+      if (large) {
+        large_jump1 = reinterpret_cast<const LargeJump *>(block + data_head.jump1_offset);
+        large_jump2 = reinterpret_cast<const LargeJump *>(block + data_head.jump2_offset);
+      } else {
+        jump1 = reinterpret_cast<const Jump *>(block + data_head.jump1_offset);
+        jump2 = reinterpret_cast<const Jump *>(block + data_head.jump2_offset);
+      }
     }
 
     word_block = block + data_head.word_offset;
@@ -501,13 +1194,91 @@ namespace {
     word_lookup.parms().block_begin = word_block;
     word_lookup.parms().hash .lang     = lang();
     word_lookup.parms().equal.cmp.lang = lang();
-    const u32int * begin = reinterpret_cast<const u32int *>
-      (block + data_head.hash_offset);
-    word_lookup.vector().set(begin, begin + data_head.word_buckets);
+    if (large) {
+      if (data_head.hash_offset + data_head.word_buckets * 8 > block_size)
+        return make_err(bad_file_format, fn);
+      large_word_lookup.parms().block_begin = word_block;
+      large_word_lookup.parms().hash .lang     = lang();
+      large_word_lookup.parms().equal.cmp.lang = lang();
+      const u64int * begin = reinterpret_cast<const u64int *>
+        (block + data_head.hash_offset);
+      large_word_lookup.vector().set(begin, begin + data_head.word_buckets);
+      large_word_lookup.set_size(data_head.word_count);
+    } else if (bucketed) {
+      if (data_head.word_buckets == 0 
+          || data_head.hash_offset 
+             + (u64int)data_head.word_buckets * sizeof(HashBucket) > block_size)
+        return make_err(bad_file_format, fn);
+      bucket_hash.bucket_count = data_head.word_buckets;
+      bucket_hash.buckets = reinterpret_cast<const HashBucket *>
+        (block + data_head.hash_offset);
+    } else {
+      const u32int * begin = reinterpret_cast<const u32int *>
+        (block + data_head.hash_offset);
+      word_lookup.vector().set(begin, begin + data_head.word_buckets);
+    }
     word_lookup.set_size(data_head.word_count);
+
+    for (Vector<LargeSectionHead>::const_iterator i = sections.begin();
+         i != sections.end(); ++i)
+    {
+      if (i->offset + i->size > block_size)
+        return make_err(bad_file_format, fn);
+      const u32int * d = reinterpret_cast<const u32int *>(block + i->offset);
+      switch (i->id) {
+      case PERFECT_HASH_SECTION:
+        if (i->version != 1 || i->size < 16 
+            || 16 + 4 * ((u64int)d[1] + d[2]) > i->size)
+          break;
+        perfect_hash.seed = d[0];
+        perfect_hash.bucket_count = d[1];
+        perfect_hash.slot_count = d[2];
+        perfect_hash.disp = d + 4;
+        perfect_hash.slots = d + 4 + d[1];
+        break;
+      case SOUNDSLIKE_INDEX_SECTION:
+        if (i->version != 1 || i->size < 16 || invisible_soundslike
+            || front_coded
+            || 16 + sizeof(SoundslikeNode) * (u64int)d[0] > i->size)
+          break;
+        soundslike_index.size = d[0];
+        soundslike_index.nodes = reinterpret_cast<const SoundslikeNode *>(d + 4);
+        break;
+      case DELETION_INDEX_SECTION:
+        if (i->version != 1 || i->size < 16 || front_coded
+            || 16 + 4 * ((u64int)d[1] + 1 + d[2]) > i->size)
+          break;
+        deletion_index.max_deletions = d[0];
+        deletion_index.bucket_count = d[1];
+        deletion_index.buckets = d + 4;
+        deletion_index.entries = d + 4 + d[1] + 1;
+        break;
+      case BLOOM_FILTER_SECTION:
+        if (i->version != 1 || i->size < 16
+            || 16 + 64 * (u64int)d[1] > i->size || d[1] == 0)
+          break;
+        bloom_filter.seed = d[0];
+        bloom_filter.block_count = d[1];
+        bloom_filter.blocks = reinterpret_cast<const u64int *>(d + 4);
+        break;
+      }
+    }
     
     //low_level_dump();
-    RET_ON_ERR(check_hash_fun());
+
+    if (have_fp) {
+      // the perfect hash and the bucket hash do not depend on the
+      // platform hash function, but all of them use the clean table
+      HeadFingerprint cur;
+      fingerprint(lang(), cur);
+      if (cur.clean != fp.clean
+          || (!perfect_hash.slots && !bucket_hash.buckets 
+              && cur.hash_fun != fp.hash_fun))
+        return make_err(bad_file_format, fn, 
+                        _("Incompatible hash function."));
+    } else if (!perfect_hash.slots) {
+      RET_ON_ERR(check_hash_fun());
+    }
     
     return no_err;
   }
@@ -543,9 +1314,8 @@ namespace {
                             WordEntry & o) const 
   {
     o.clear();
-    WordLookup::const_iterator i = word_lookup.find(word);
-    if (i == word_lookup.end()) return false;
-    const char * w = word_block + *i;
+    const char * w = find(word);
+    if (!w) return false;
     for (;;) {
       if ((*c)(word, w)) {
         convert(w,o);
@@ -558,26 +1328,40 @@ namespace {
     return false;
   }
 
+  template <class J>
   struct ReadOnlyDict::SoundslikeElements : public SoundslikeEnumeration
   {
     WordEntry data;
     const ReadOnlyDict * obj;
-    const Jump * jump1;
-    const Jump * jump2;
+    const J * jump2_begin;
+    const J * jump1;
+    const J * jump2;
     const char * cur;
     const char * prev;
     int level;
     bool invisible_soundslike;
+    bool front_coded;
+    char sl[256 + 16]; // the decoded soundslike when front coded, with
+                       // room for the fixed size copies in next()
+    int sl_size;
+    const SoundslikeIndex & index;
+    u32int cur_node; // index node of cur, if there is an index
+    const J * jump1_end; // where the part ends, see soundslike_part
+    bool part_start; // return the soundslike of jump1 first
 
     WordEntry * next(int stopped_at);
 
-    SoundslikeElements(const ReadOnlyDict * o)
-      : obj(o), jump1(obj->jump1), jump2(obj->jump2), cur(0), 
-        level(1), invisible_soundslike(o->invisible_soundslike) {
+    SoundslikeElements(const ReadOnlyDict * o, const J * j1, const J * j2)
+      : obj(o), jump2_begin(j2), jump1(j1), jump2(j2), cur(0), 
+        level(1), invisible_soundslike(o->invisible_soundslike),
+        front_coded(o->front_coded), sl_size(0),
+        index(o->soundslike_index), cur_node(0),
+        jump1_end(0), part_start(false) {
       data.what = o->invisible_soundslike ? WordEntry::Word : WordEntry::Soundslike;}
   };
 
-  WordEntry * ReadOnlyDict::SoundslikeElements::next(int stopped_at) {
+  template <class J>
+  WordEntry * ReadOnlyDict::SoundslikeElements<J>::next(int stopped_at) {
 
     //CERR << level << ":" << stopped_at << "  :";
     //CERR << jump1->sl << ":" << jump2->sl << "\n";
@@ -587,7 +1371,13 @@ namespace {
     const char * tmp = cur;
     const char * p;
 
-    if (level == 1 && stopped_at < 2) {
+    if (part_start) {
+
+      part_start = false;
+      tmp = jump1->sl;
+      goto jquit;
+
+    } else if (level == 1 && stopped_at < 2) {
 
       ++jump1;
       tmp = jump1->sl;
@@ -608,7 +1398,7 @@ namespace {
     } else if (level == 1) {
 
       level = 2;
-      jump2 = obj->jump2 + jump1->loc;
+      jump2 = jump2_begin + jump1->loc;
       tmp = jump2->sl;
       goto jquit;
 
@@ -616,6 +1406,30 @@ namespace {
 
       tmp = cur = obj->word_block + jump2->loc;
       level = 3;
+      if (index.nodes) cur_node = index.find(jump2->loc);
+
+    } else if (index.nodes && prev 
+               && stopped_at >= 3 && stopped_at < LARGE_NUM 
+               && get_offset(cur) != 0) {
+
+      // skip everything that shares the first stopped_at + 1
+      // characters with prev, since stopped_at >= 3 this will stay
+      // within the current jump2 group
+      u32int n = index.skip(cur_node, stopped_at + 1);
+      if (n != cur_node) {
+        if (n < index.size && index.nodes[n].depth >= 3) {
+          cur = obj->word_block + index.nodes[n].offset;
+          cur_node = n;
+        } else if (n < index.size) {
+          // the end of a group is just before the header of the
+          // next soundslike, see create()
+          cur = obj->word_block + index.nodes[n].offset - 1;
+        } else {
+          while (get_offset(cur) != 0) cur = get_next(cur);
+        }
+      }
+      stopped_at = LARGE_NUM;
+      goto loop;
 
     } else if (get_offset(cur) == 0) {
 
@@ -633,9 +1447,31 @@ namespace {
     } 
 
     cur = get_next(cur); // this will be the NEXT item looked at
+    ++cur_node;
 
     p = prev;
     prev = tmp;
+    if (front_coded) {
+      // the same test as below, but since the prefix shared with p
+      // is known there is no need to compare, p and tmp are only the
+      // same when a large group was split
+      int shared = get_sl_shared(tmp);
+      int size = get_word_size(tmp);
+      bool same = shared == sl_size && size == 0;
+      // most suffixes are short so copy a fixed size, this will not
+      // read past the block since the words follow the soundslike
+      if (size < 16) memcpy(sl + shared, tmp, 16);
+      else           memcpy(sl + shared, tmp, size);
+      sl_size = shared + size;
+      sl[sl_size] = '\0';
+      if (p && stopped_at >= 3 && stopped_at <= 5 
+          && (shared > stopped_at || (same && shared == stopped_at)))
+        goto loop;
+      data.word = sl;
+      data.word_size = sl_size;
+      data.intr[0] = (void *)tmp;
+      return &data;
+    }
     if (p) {
       // PRECOND:
       // unless stopped_at >= LARGE_NUM
@@ -666,7 +1502,7 @@ namespace {
 
   jquit:
     prev = 0;
-    if (!*tmp) return 0;
+    if (!*tmp || (level == 1 && jump1 == jump1_end)) return 0;
     data.word = tmp;
     data.word_size = !tmp[1] ? 1 : !tmp[2] ? 2 : 3;
     data.intr[0] = 0;
@@ -677,53 +1513,224 @@ namespace {
     return &data;
   }
 
-  SoundslikeEnumeration * ReadOnlyDict::soundslike_elements() const {
-
-    return new SoundslikeElements(this);
-
-  }
-    
-  static void soundslike_next(WordEntry * w)
+  void ReadOnlyDict::warm() const
   {
-    const char * cur = (const char *)(w->intr[0]);
-    const char * end = (const char *)(w->intr[1]);
-    convert(cur, *w);
-    cur = get_next(cur);
-    w->intr[0] = (void *)cur;
-    if (cur >= end) w->adv_ = 0;
+    char * b = mmaped_block ? mmaped_block : block;
+    size_t size = mmaped_block ? mmaped_size : block_size;
+    if (mmaped_block) mmap_advise(b, size, true, false);
+    // read a byte from each page, the volatile keeps the compiler
+    // from removing the loop
+    const volatile char * p = b;
+    size_t page = page_size();
+    for (size_t i = 0; i < size; i += page)
+      (void)p[i];
   }
 
-  static void clean_lookup_adv(WordEntry * wi) 
+  // Only the first memory access of find is prefetched, the rest
+  // depends on it.
+  void ReadOnlyDict::prefetch(ParmString word) const
   {
-    const char * w = wi->word;
-    w = get_next(w);
-    convert(w,*wi);
-    if (!duplicate_flag(w)) wi->adv_ = 0;
+    if (bloom_filter.blocks) {
+      u64int h = clean_hash(lang(), word, bloom_filter.seed);
+      PREFETCH(bloom_filter.blocks + BloomFilter::block(bloom_filter.block_count, h));
+    } else if (perfect_hash.slots) {
+      u64int h = clean_hash(lang(), word, perfect_hash.seed);
+      PREFETCH(perfect_hash.disp + perfect_hash.bucket(h));
+    } else if (bucket_hash.buckets) {
+      u64int h = clean_hash(lang(), word, 0);
+      PREFETCH(bucket_hash.buckets + BucketHash::bucket(bucket_hash.bucket_count, h));
+    } else if (large) {
+      PREFETCH(large_word_lookup.first_slot(word));
+    } else {
+      PREFETCH(word_lookup.first_slot(word));
+    }
   }
 
-  bool ReadOnlyDict::clean_lookup(ParmString sl, WordEntry & o) const
+  bool ReadOnlyDict::memory_usage(size_t & size, size_t & resident) const
   {
-    o.clear();
-    WordLookup::const_iterator i = word_lookup.find(sl);
-    if (i == word_lookup.end()) return false;
-    const char * w = word_block + *i;
-    convert(w, o);
-    if (duplicate_flag(w)) o.adv_ = clean_lookup_adv;
+    if (mmaped_block) {
+      size = mmaped_size;
+      return resident_size(mmaped_block, mmaped_size, resident);
+    } else {
+      size = block_size;
+      resident = block_size;
+    }
     return true;
   }
-    
-  bool ReadOnlyDict::soundslike_lookup(const WordEntry & s, WordEntry & w) const 
-  {
-    if (s.intr[0] == 0) {
 
-      return false;
+  SoundslikeEnumeration * ReadOnlyDict::soundslike_elements() const {
 
-    } else if (!invisible_soundslike) {
-      
-      w.clear();
+    if (large)
+      return new SoundslikeElements<LargeJump>(this, large_jump1, large_jump2);
+    else
+      return new SoundslikeElements<Jump>(this, jump1, jump2);
+
+  }
+    
+  //
+  // The parts are made of whole jump1 groups, split so that each part
+  // has about the same amount of the data block.  A part starts by
+  // returning the soundslike of its first group, as if next() had
+  // just advanced jump1 to it, and ends when jump1 is advanced to the
+  // first group of the next part.
+  //
+  // next() only notices that a new jump1 group started when the second
+  // letter changes, so it may go on into the next group without
+  // advancing jump1.  It then catches up at the next change it does
+  // notice, which returns to the group that was missed.  Thus a part
+  // may only start at a group if a later change is noticed, otherwise
+  // the whole enumeration never gets to the start of the part.
+  //
+
+  template <class J>
+  SoundslikeEnumeration * 
+  ReadOnlyDict::soundslike_part(const J * j1, const J * j2,
+                                unsigned part, unsigned num_parts) const
+  {
+    size_t size = 0;
+    while (*j1[size].sl) ++size;
+    size_t size2 = 0;
+    while (*j2[size2].sl) ++size2;
+    // the last group a part can start at
+    size_t last = size;
+    while (last > 0) {
+      size_t i = last < size ? j1[last].loc : size2;
+      if (j2[i - 1].sl[1] != j2[i].sl[1]) break;
+      --last;
+    }
+    if (last > 0 && last == size) --last;
+    // the first group of part p
+    size_t begin = 0, end = size;
+    if (last > 0) {
+      u64int first_loc = j2[j1[0].loc].loc;
+      u64int data_size = j2[j1[last].loc].loc - first_loc;
+      size_t i = 1;
+      for (unsigned p = 1; p <= part + 1 && p < num_parts; ++p) {
+        u64int loc = first_loc + data_size * p / num_parts;
+        while (i < last && j2[j1[i].loc].loc < loc) ++i;
+        if (p == part)     begin = i;
+        if (p == part + 1) end = i;
+      }
+    } else if (part > 0) {
+      begin = size;
+    }
+    SoundslikeElements<J> * els = new SoundslikeElements<J>(this, j1 + begin, j2);
+    els->jump1_end = j1 + end;
+    els->part_start = begin > 0;
+    return els;
+  }
+
+  SoundslikeEnumeration * 
+  ReadOnlyDict::soundslike_part(unsigned part, unsigned num_parts) const 
+  {
+    if (large)
+      return soundslike_part(large_jump1, large_jump2, part, num_parts);
+    else if (jump1)
+      return soundslike_part(jump1, jump2, part, num_parts);
+    else
+      return 0;
+  }
+
+  //
+  // Enumerates the soundslike strings found via the deletion index,
+  // in the same order as SoundslikeElements.
+  //
+
+  struct ReadOnlyDict::NeighborElements : public SoundslikeEnumeration
+  {
+    WordEntry data;
+    const ReadOnlyDict * obj;
+    Vector<u32int> offsets;
+    Vector<u32int>::const_iterator cur;
+    const u32int * buckets;
+    u32int bucket_count;
+
+    void add(u64int h) {
+      u32int b = DeletionIndex::bucket(bucket_count, h);
+      offsets.insert(offsets.end(), 
+                     obj->deletion_index.entries + buckets[b],
+                     obj->deletion_index.entries + buckets[b+1]);
+    }
+
+    WordEntry * next(int) {
+      if (cur == offsets.end()) return 0;
+      const char * w = obj->word_block + *cur;
+      ++cur;
+      data.word = w;
+      data.word_size = get_word_size(w);
+      if (obj->invisible_soundslike)
+        convert(w, data);
+      data.intr[0] = (void *)w;
+      return &data;
+    }
+
+    NeighborElements(const ReadOnlyDict * o) 
+      : obj(o), buckets(o->deletion_index.buckets), 
+        bucket_count(o->deletion_index.bucket_count) {
+      data.what = o->invisible_soundslike ? WordEntry::Word : WordEntry::Soundslike;}
+  };
+
+  SoundslikeEnumeration * 
+  ReadOnlyDict::soundslike_neighbors(const char * const * sls,
+                                     const char * const * sls_end,
+                                     int max_dist) const 
+  {
+    if (!deletion_index.entries || max_dist < 0
+        || (u32int)max_dist > deletion_index.max_deletions)
+      return 0;
+    NeighborElements * els = new NeighborElements(this);
+    for (; sls != sls_end; ++sls)
+      deletion_hashes(*sls, strlen(*sls), max_dist, *els);
+    std::sort(els->offsets.begin(), els->offsets.end());
+    els->offsets.erase(std::unique(els->offsets.begin(), els->offsets.end()),
+                       els->offsets.end());
+    els->cur = els->offsets.begin();
+    return els;
+  }
+
+  static void soundslike_next(WordEntry * w)
+  {
+    const char * cur = (const char *)(w->intr[0]);
+    const char * end = (const char *)(w->intr[1]);
+    convert(cur, *w);
+    cur = get_next(cur);
+    w->intr[0] = (void *)cur;
+    if (cur >= end) w->adv_ = 0;
+  }
+
+  static void clean_lookup_adv(WordEntry * wi) 
+  {
+    const char * w = wi->word;
+    w = get_next(w);
+    convert(w,*wi);
+    if (!duplicate_flag(w)) wi->adv_ = 0;
+  }
+
+  bool ReadOnlyDict::clean_lookup(ParmString sl, WordEntry & o) const
+  {
+    o.clear();
+    const char * w = find(sl);
+    if (!w) return false;
+    convert(w, o);
+    if (duplicate_flag(w)) o.adv_ = clean_lookup_adv;
+    return true;
+  }
+    
+  bool ReadOnlyDict::soundslike_lookup(const WordEntry & s, WordEntry & w) const 
+  {
+    if (s.intr[0] == 0) {
+
+      return false;
+
+    } else if (!invisible_soundslike) {
+      
+      // intr[0] is used rather than word since the latter is a copy
+      // when the soundslike is front coded
+      const char * sl = (const char *)s.intr[0];
+      w.clear();
       w.what = WordEntry::Word;
-      w.intr[0] = (void *)get_sl_words_begin(s.word);
-      w.intr[1] = (void *)get_sl_words_end(s.word);
+      w.intr[0] = (void *)get_sl_words_begin(sl, word_head);
+      w.intr[1] = (void *)get_sl_words_end(sl);
       w.adv_ = soundslike_next;
       soundslike_next(&w);
       return true;
@@ -780,10 +1787,12 @@ namespace {
     WordData * next;
     char * sl;
     char * aff;
+    u32int seq; // position in the word list
     byte word_size;
     byte sl_size;
     byte data_size;
     byte flags;
+    byte freq;
     char word[1];
   };
 
@@ -798,42 +1807,837 @@ namespace {
       if (res != 0) return res < 0;
       res = icomp(x->word, y->word);
       if (res != 0) return res < 0;
-      return strcmp(x->word, y->word) < 0;
+      res = strcmp(x->word, y->word);
+      if (res != 0) return res < 0;
+      // so that the order does not depend on how the list was sorted
+      return x->seq < y->seq;
     }
   };
 
+  static const u64int u64int_max = (u64int)-1;
+
+  // the offsets are 64 bit so that the same table can be used for
+  // all versions, they are narrowed when written if possible
   struct WordLookupParms {
     const char * block_begin;
     WordLookupParms() {}
-    typedef acommon::Vector<u32int> Vector;
-    typedef u32int              Value;
+    typedef acommon::Vector<u64int> Vector;
+    typedef u64int              Value;
     typedef const char *        Key;
     static const bool is_multi = false;
     Key key(Value v) const {return block_begin + v;}
     InsensitiveHash<hash_int_t> hash;
     InsensitiveEqual equal;
-    bool is_nonexistent(Value v) const {return v == u32int_max;}
-    void make_nonexistent(Value & v) const {v = u32int_max;}
+    bool is_nonexistent(Value v) const {return v == u64int_max;}
+    void make_nonexistent(Value & v) const {v = u64int_max;}
   };
   typedef VectorHashTable<WordLookupParms> WordLookup;
 
-  static inline unsigned int round_up(unsigned int i, unsigned int size) {
+  static inline u64int round_up(u64int i, unsigned int size) {
     return ((i + size - 1)/size)*size;
   }
 
-  static void advance_file(FStream & out, int pos) {
-    int diff = pos - out.tell();
+  static void advance_file(FStream & out, u64int pos) {
+    long diff = pos - out.tell();
     assert(diff >= 0);
     for(; diff != 0; --diff)
       out << '\0';
   }
 
+  // Writes the jump table using J's for the entries
+  template <class J>
+  static void write_jumps(FStream & out, const Vector<LargeJump> & jumps)
+  {
+    Vector<J> res(jumps.size());
+    for (unsigned i = 0; i != jumps.size(); ++i) {
+      memcpy(res[i].sl, jumps[i].sl, sizeof(res[i].sl));
+      res[i].loc = jumps[i].loc;
+    }
+    write_block(out, (const char *)res.data(), res.size() * sizeof(J));
+  }
+
+  struct PerfectHashOrder {
+    const Vector<u64int> & hashes;
+    const Vector<u32int> & bucket_of;
+    const Vector<u32int> & bucket_size;
+    PerfectHashOrder(const Vector<u64int> & h, const Vector<u32int> & b,
+                     const Vector<u32int> & s)
+      : hashes(h), bucket_of(b), bucket_size(s) {}
+    // largest buckets first, keys of a bucket are kept together
+    bool operator() (u32int x, u32int y) const {
+      u32int bx = bucket_of[x], by = bucket_of[y];
+      if (bucket_size[bx] != bucket_size[by]) 
+        return bucket_size[bx] > bucket_size[by];
+      if (bx != by) return bx < by;
+      return hashes[x] < hashes[y];
+    }
+  };
+
+  // Writes a PERFECT_HASH_SECTION for all the words in lookup and
+  // returns the seed used
+  static u32int write_perfect_hash(FStream & out, const WordLookup & lookup, 
+                                 const char * block, const Language & lang)
+  {
+    Vector<u32int> words;
+    for (WordLookup::const_iterator i = lookup.begin(); i != lookup.end(); ++i)
+      words.push_back(*i);
+    u32int n = words.size();
+    assert(n < PH_DIRECT);
+
+    PerfectHash ph;
+    ph.bucket_count = n/2 + 1;
+    ph.slot_count = n;
+    Vector<u64int> hashes(n);
+    Vector<u32int> bucket_of(n);
+    Vector<u32int> bucket_size(ph.bucket_count);
+    Vector<u32int> order(n);
+    Vector<u32int> disp(ph.bucket_count);
+    Vector<u32int> slots(n);
+    Vector<byte>   taken(n);
+    u32int cur[256];
+
+    for (ph.seed = 0;; ++ph.seed) {
+
+      memset(bucket_size.data(), 0, ph.bucket_count * 4);
+      for (u32int i = 0; i != n; ++i) {
+        hashes[i] = clean_hash(&lang, block + words[i], ph.seed);
+        bucket_of[i] = ph.bucket(hashes[i]);
+        ++bucket_size[bucket_of[i]];
+        order[i] = i;
+      }
+      std::sort(order.begin(), order.end(), 
+                PerfectHashOrder(hashes, bucket_of, bucket_size));
+
+      memset(disp.data(), 0, ph.bucket_count * 4);
+      memset(taken.data(), 0, n);
+
+      u32int j = 0;
+      bool ok = true;
+      while (ok && j != n && bucket_size[bucket_of[order[j]]] > 1) {
+        u32int b = bucket_of[order[j]];
+        u32int k = bucket_size[b];
+        if (k > 256) {ok = false; break;}
+        for (u32int d = 0;; ++d) {
+          if (d == (1u << 20)) {ok = false; break;}
+          u32int t = 0;
+          for (; t != k; ++t) {
+            u32int s = PerfectHash::slot(hashes[order[j+t]], d, n);
+            if (taken[s]) break;
+            u32int u = 0;
+            while (u != t && cur[u] != s) ++u;
+            if (u != t) break; // also when two keys have the same hash
+            cur[t] = s;
+          }
+          if (t != k) continue;
+          for (t = 0; t != k; ++t) {
+            taken[cur[t]] = true;
+            slots[cur[t]] = words[order[j+t]];
+          }
+          disp[b] = d;
+          break;
+        }
+        j += k;
+      }
+      if (!ok) continue;
+
+      // only buckets with a single key are left
+      u32int s = 0;
+      for (; j != n; ++j) {
+        while (taken[s]) ++s;
+        taken[s] = true;
+        slots[s] = words[order[j]];
+        disp[bucket_of[order[j]]] = PH_DIRECT | s;
+      }
+      break;
+    }
+
+    out.write32(ph.seed);
+    out.write32(ph.bucket_count);
+    out.write32(ph.slot_count);
+    out.write32(0);
+    out.write(disp.data(), ph.bucket_count * 4);
+    out.write(slots.data(), n * 4);
+    return ph.seed;
+  }
+
+  // Writes a BLOOM_FILTER_SECTION for all the words in lookup
+  static void write_bloom_filter(FStream & out, const WordLookup & lookup,
+                                 const char * block, const Language & lang,
+                                 u32int seed)
+  {
+    u32int block_count = (lookup.size() * BLOOM_BITS_PER_KEY + 511) / 512;
+    if (block_count == 0) block_count = 1;
+    Vector<u64int> blocks(block_count * 8, 0);
+    for (WordLookup::const_iterator i = lookup.begin(); i != lookup.end(); ++i)
+      BloomFilter::set(blocks.data(), block_count, 
+                       clean_hash(&lang, block + *i, seed));
+    out.write32(seed);
+    out.write32(block_count);
+    out.write32(0);
+    out.write32(0);
+    out.write(blocks.data(), block_count * 64);
+  }
+
+  // Writes the words in lookup as a table of HashBucket's and
+  // returns the number of buckets
+  static u32int write_bucket_hash(FStream & out, const WordLookup & lookup,
+                                  const char * block, const Language & lang)
+  {
+    // insert the words in the order they appear in the data block so
+    // that the result does not depend on the platform hash function
+    Vector<u32int> words;
+    for (WordLookup::const_iterator i = lookup.begin(); i != lookup.end(); ++i)
+      words.push_back(*i);
+    std::sort(words.begin(), words.end());
+
+    // keep the buckets about 80% full
+    u32int bucket_count = words.size() / (BUCKET_ENTRIES * 8 / 10) + 1;
+    Vector<HashBucket> buckets(bucket_count);
+    for (Vector<u32int>::const_iterator i = words.begin(); i != words.end(); ++i) {
+      u64int h = clean_hash(&lang, block + *i, 0);
+      u32int b = BucketHash::bucket(bucket_count, h);
+      while (buckets[b].size == BUCKET_ENTRIES) {
+        buckets[b].overflow = true;
+        if (++b == bucket_count) b = 0;
+      }
+      HashBucket & bucket = buckets[b];
+      bucket.fingerprint[bucket.size] = BucketHash::fingerprint(h);
+      bucket.offset[bucket.size] = *i;
+      ++bucket.size;
+    }
+    out.write(buckets.data(), bucket_count * sizeof(HashBucket));
+    return bucket_count;
+  }
+
+  // Writes a SOUNDSLIKE_INDEX_SECTION given the soundslike strings in
+  // sorted order and their offsets in the word block
+  static void write_soundslike_index(FStream & out, 
+                                     const Vector<const char *> & sls,
+                                     const Vector<u32int> & offsets)
+  {
+    u32int n = sls.size();
+    Vector<SoundslikeNode> nodes(n);
+    Vector<u32int> open; // nodes whose next is not known yet
+    for (u32int i = 0; i != n; ++i) {
+      SoundslikeNode & node = nodes[i];
+      node.offset = offsets[i];
+      if (i != 0) {
+        const char * x = sls[i-1];
+        const char * y = sls[i];
+        unsigned depth = 0;
+        while (x[depth] == y[depth] && x[depth]) ++depth;
+        if (x[depth] == y[depth]) ++depth; // equal
+        node.depth = depth;
+      }
+      while (!open.empty() && nodes[open.back()].depth > node.depth) {
+        nodes[open.back()].next = i;
+        open.pop_back();
+      }
+      open.push_back(i);
+    }
+    for (Vector<u32int>::const_iterator i = open.begin(); i != open.end(); ++i)
+      nodes[*i].next = n;
+    out.write32(n);
+    out.write32(0);
+    out.write32(0);
+    out.write32(0);
+    out.write(nodes.data(), n * sizeof(SoundslikeNode));
+  }
+
+  struct DeletionEntry {
+    u32int bucket;
+    u32int offset;
+    bool operator< (const DeletionEntry & o) const {
+      return bucket != o.bucket ? bucket < o.bucket : offset < o.offset;
+    }
+    bool operator== (const DeletionEntry & o) const {
+      return bucket == o.bucket && offset == o.offset;
+    }
+  };
+
+  struct DeletionHashes {
+    Vector<u64int> hashes;
+    void add(u64int h) {hashes.push_back(h);}
+  };
+
+  // Writes a DELETION_INDEX_SECTION given the soundslike strings and
+  // the offsets in the word block of the entries for them
+  static void write_deletion_index(FStream & out, 
+                                   const Vector<const char *> & sls,
+                                   const Vector<u32int> & offsets)
+  {
+    DeletionHashes dh;
+    Vector<u32int> owner;
+    for (u32int i = 0; i != sls.size(); ++i) {
+      deletion_hashes(sls[i], strlen(sls[i]), 
+                      DELETION_INDEX_MAX_DELETIONS, dh);
+      owner.resize(dh.hashes.size(), offsets[i]);
+    }
+    u32int bucket_count = dh.hashes.size() / 2 + 1;
+    Vector<DeletionEntry> entries(dh.hashes.size());
+    for (u32int i = 0; i != entries.size(); ++i) {
+      entries[i].bucket = DeletionIndex::bucket(bucket_count, dh.hashes[i]);
+      entries[i].offset = owner[i];
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    Vector<u32int> buckets(bucket_count + 1);
+    for (u32int i = 0; i != entries.size(); ++i)
+      ++buckets[entries[i].bucket + 1];
+    for (u32int b = 0; b != bucket_count; ++b)
+      buckets[b + 1] += buckets[b];
+    out.write32(DELETION_INDEX_MAX_DELETIONS);
+    out.write32(bucket_count);
+    out.write32(entries.size());
+    out.write32(0);
+    out.write(buckets.data(), buckets.size() * 4);
+    for (u32int i = 0; i != entries.size(); ++i)
+      out.write32(entries[i].offset);
+  }
+
+  //
+  // When create-memory is set the word data is not all kept in
+  // memory.  Instead, once a builder uses more than its share, its
+  // words are sorted and written to a temporary file as a run.  The
+  // runs are then merged when laying out the data block.
+  //
+  // A spilled word is a SpillHead followed by the word, the affix
+  // flags (if any), and the soundslike (if different from the word),
+  // each null terminated.
+  //
+
+  struct SpillHead {
+    u32int seq;
+    byte word_size;
+    byte sl_size;
+    byte data_size;
+    byte flags;
+    byte have_sl;
+    byte freq;
+    byte reserved[2];
+  };
+
+  static const unsigned MAX_SPILL_RECORD = sizeof(SpillHead) + 3*256;
+
+  struct SpillRun {
+    FStream * file;
+    long begin;
+    long end;
+  };
+
+  static void write_spilled(FStream & out, const WordData * w)
+  {
+    SpillHead head;
+    memset(&head, 0, sizeof(head));
+    head.seq = w->seq;
+    head.word_size = w->word_size;
+    head.sl_size = w->sl_size;
+    head.data_size = w->data_size;
+    head.flags = w->flags;
+    head.have_sl = w->sl != w->word;
+    head.freq = w->freq;
+    out.write(&head, sizeof(head));
+    out.write(w->word, w->word_size + 1);
+    if (w->aff) out.write(w->aff, w->data_size - w->word_size - 1);
+    if (head.have_sl) out.write(w->sl, w->sl_size + 1);
+  }
+
+  //
+  // Expands the affixes of each word, as needed, and creates the
+  // WordData for them.  When create-threads is larger than one,
+  // several builders are used at once, one per thread.
+  //
+
+  class WordDataBuilder {
+    const Language & lang;
+    bool affix_compress;
+    bool partially_expand;
+    ObjStack exp_buf;
+    String sl_buf;
+    WordData * * prev;
+    size_t mem_limit;
+    size_t mem_used;
+    StackPtr<FStream> spill_file;
+  public:
+    ObjStack buf;
+    WordData * first;
+    Vector<SpillRun> runs;
+    WordDataBuilder(const Language & l, bool ac, bool pe, size_t ml)
+      : lang(l), affix_compress(ac), partially_expand(pe), 
+        prev(&first), mem_limit(ml), mem_used(0),
+        buf(16*1024), first(0) {}
+    PosibErr<void> add(const char * w, const char * affixes, u32int seq,
+                       byte freq);
+    // sorts the words in memory and writes them out as a new run
+    PosibErr<void> spill();
+  };
+
+  PosibErr<void> WordDataBuilder::spill()
+  {
+    if (!first) return no_err;
+    if (!spill_file) {
+      FILE * f = tmpfile();
+      if (!f) return make_err(cant_write_file, _("a temporary file"));
+      spill_file.reset(new FStream(f));
+    }
+    SpillRun run;
+    run.file = spill_file;
+    run.begin = spill_file->tell();
+    first = sort(first, SoundslikeLess(&lang));
+    for (WordData * p = first; p; p = p->next)
+      write_spilled(*spill_file, p);
+    spill_file->flush();
+    if (ferror(spill_file->c_stream()))
+      return make_err(cant_write_file, _("a temporary file"));
+    run.end = spill_file->tell();
+    runs.push_back(run);
+    buf.reset();
+    first = 0;
+    prev = &first;
+    mem_used = 0;
+    return no_err;
+  }
+
+  PosibErr<void> WordDataBuilder::add(const char * w, const char * affixes,
+                                      u32int seq, byte freq)
+  {
+    WordAff * exp_list;
+    WordAff single;
+    single.next = 0;
+
+    if (*affixes && !lang.affix())
+      return make_err(other_error, 
+                      _("Affix flags found in word but no affix file given."));
+
+    if (*affixes && !affix_compress) {
+      exp_buf.reset();
+      exp_list = lang.affix()->expand(w, affixes, exp_buf);
+    } else if (*affixes && partially_expand) {
+      // expand any affixes which will effect the first
+      // 3 letters of a word.  This is needed so that the
+      // jump tables will function correctly
+      exp_buf.reset();
+      exp_list = lang.affix()->expand(w, affixes, exp_buf, 3);
+    } else {
+      single.word.str = w;
+      single.word.size = strlen(w);
+      single.aff = (const byte *)affixes;
+      exp_list = &single;
+    }
+
+    // iterate through each expanded word
+        
+    for (WordAff * p = exp_list; p; p = p->next)
+    {
+      const char * w = p->word.str;
+      unsigned s = p->word.size;
+          
+      unsigned total_size = WordData::struct_size;
+      unsigned data_size = s + 1;
+      unsigned aff_size = strlen((const char *)p->aff);
+      if (aff_size > 0) data_size += aff_size + 1;
+      total_size += data_size;
+      lang.to_soundslike(sl_buf, w);
+      const char * sl = sl_buf.str();
+      unsigned sl_size = sl_buf.size();
+      if (strcmp(sl,w) == 0) sl = w;
+      if (sl != w) total_size += sl_size + 1;
+
+      if (total_size - WordData::struct_size > 240)
+        return make_err(invalid_word, MsgConv(lang)(w),
+                        _("The total word length, with soundslike data, is larger than 240 characters."));
+
+      WordData * b = (WordData *)buf.alloc(total_size, sizeof(void *));
+      *prev = b;
+      b->next = 0;
+      prev = &b->next;
+          
+      b->seq = seq;
+      b->word_size = s;
+      b->sl_size = strlen(sl);
+      b->data_size = data_size;
+      b->flags = lang.get_word_info(w);
+      b->freq = freq;
+
+      char * z = b->word;
+
+      memcpy(z, w, s + 1);
+      z += s + 1;
+
+      if (aff_size > 0) {
+        b->flags |= HAVE_AFFIX_FLAG;
+        b->aff = z;
+        memcpy(z, p->aff, aff_size + 1);
+        z += aff_size + 1;
+      } else {
+        b->aff = 0;
+      }
+
+      if (sl != w) {
+        memcpy(z, sl, sl_size + 1);
+        b->sl = z;
+      } else {
+        b->sl = b->word;
+      }
+
+      mem_used += total_size;
+    }
+    if (mem_limit && mem_used > mem_limit)
+      return spill();
+    return no_err;
+  }
+
+  struct WordDataBuilders : public Vector<WordDataBuilder *> {
+    void clear() {
+      for (iterator i = begin(); i != end(); ++i) delete *i;
+      Vector<WordDataBuilder *>::clear();}
+    ~WordDataBuilders() {clear();}
+  };
+
+  struct BatchWord {
+    const char * word;
+    const char * aff;
+    u32int seq;
+    byte freq;
+  };
+
+  struct WordDataTask {
+    WordDataBuilder * builder;
+    const BatchWord * begin;
+    const BatchWord * end;
+    PosibErr<void> err;
+    void run() {
+      for (const BatchWord * i = begin; i != end; ++i) {
+        err = builder->add(i->word, i->aff, i->seq, i->freq);
+        if (err.has_err()) return;
+      }
+    }
+  };
+
+  struct WordDataSortTask {
+    WordData * first;
+    const Language * less;
+    void run() {first = sort(first, SoundslikeLess(less));}
+  };
+
+#ifdef USE_POSIX_MUTEX
+  template <class Task>
+  static void * run_task(void * task) {
+    static_cast<Task *>(task)->run();
+    return 0;
+  }
+#endif
+
+  // Runs each task, in a separate thread if possible, and waits for
+  // them to finish
+  template <class Task>
+  static void run_tasks(Task * begin, Task * end)
+  {
+#ifdef USE_POSIX_MUTEX
+    Vector<pthread_t> threads(end - begin);
+    Vector<bool> started(end - begin);
+    for (Task * i = begin + 1; i < end; ++i)
+      started[i - begin] = 
+        pthread_create(&threads[i - begin], 0, run_task<Task>, i) == 0;
+    if (begin != end) begin->run();
+    for (Task * i = begin + 1; i < end; ++i) {
+      if (started[i - begin]) pthread_join(threads[i - begin], 0);
+      else i->run();
+    }
+#else
+    for (Task * i = begin; i != end; ++i)
+      i->run();
+#endif
+  }
+
+  struct WordDataSpillTask {
+    WordDataBuilder * builder;
+    PosibErr<void> err;
+    void run() {err = builder->spill();}
+  };
+
+  //
+  // The sorted words come from either a list in memory or the
+  // spilled runs.  Each source can be read more than once.
+  //
+
+  class WordDataSource {
+  public:
+    virtual void reset() = 0;
+    // the word returned is only valid until the next call
+    virtual const WordData * next() = 0;
+    virtual bool failed() const {return false;}
+    virtual ~WordDataSource() {}
+  };
+
+  class WordDataList : public WordDataSource {
+    const WordData * first;
+    const WordData * cur;
+  public:
+    WordDataList(const WordData * f) : first(f), cur(f) {}
+    void reset() {cur = first;}
+    const WordData * next() {
+      const WordData * w = cur;
+      if (w) cur = w->next;
+      return w;
+    }
+  };
+
+  class SpillRunReader {
+    SpillRun run;
+    long pos;
+    Vector<char> buf;
+    unsigned buf_begin;
+    unsigned buf_end;
+    ObjStack rec_buf;
+  public:
+    WordData * cur;
+    bool failed;
+    SpillRunReader(const SpillRun & r)
+      : run(r), pos(r.begin), buf(16*1024), buf_begin(0), buf_end(0),
+        rec_buf(1024), cur(0), failed(false) {}
+    bool adv();
+  };
+
+  bool SpillRunReader::adv()
+  {
+    if (buf_end - buf_begin < MAX_SPILL_RECORD && pos < run.end) {
+      memmove(buf.data(), buf.data() + buf_begin, buf_end - buf_begin);
+      buf_end -= buf_begin;
+      buf_begin = 0;
+      size_t n = std::min<long>(buf.size() - buf_end, run.end - pos);
+      if (!run.file->seek(pos) ||
+          fread(buf.data() + buf_end, 1, n, run.file->c_stream()) != n) {
+        failed = true;
+        return false;
+      }
+      pos += n;
+      buf_end += n;
+    }
+    if (buf_begin == buf_end) return false;
+
+    const char * d = buf.data() + buf_begin;
+    SpillHead head;
+    memcpy(&head, d, sizeof(head));
+    d += sizeof(head);
+    unsigned aff_size = head.flags & HAVE_AFFIX_FLAG 
+      ? head.data_size - head.word_size - 1 : 0;
+    unsigned sl_size = head.have_sl ? head.sl_size + 1 : 0;
+
+    rec_buf.reset();
+    WordData * w = (WordData *)rec_buf.alloc(WordData::struct_size 
+                                             + head.word_size + 1
+                                             + aff_size + sl_size,
+                                             sizeof(void *));
+    w->next = 0;
+    w->seq = head.seq;
+    w->word_size = head.word_size;
+    w->sl_size = head.sl_size;
+    w->data_size = head.data_size;
+    w->flags = head.flags;
+    w->freq = head.freq;
+    char * z = w->word;
+    memcpy(z, d, head.word_size + aff_size + sl_size + 1);
+    z += head.word_size + 1;
+    w->aff = aff_size ? z : 0;
+    z += aff_size;
+    w->sl = sl_size ? z : w->word;
+    
+    buf_begin = d - buf.data() + head.word_size + 1 + aff_size + sl_size;
+    cur = w;
+    return true;
+  }
+
+  struct SpillRunGreater {
+    SoundslikeLess less;
+    SpillRunGreater(const Language * l) : less(l) {}
+    bool operator() (SpillRunReader * x, SpillRunReader * y) const {
+      return less(y->cur, x->cur);
+    }
+  };
+
+  class SpillRunMerger : public WordDataSource {
+    Vector<SpillRun> runs;
+    Vector<SpillRunReader *> readers;
+    Vector<SpillRunReader *> heap;
+    SpillRunReader * last;
+    SpillRunGreater greater;
+    bool failed_;
+    void clear() {
+      for (unsigned i = 0; i != readers.size(); ++i) delete readers[i];
+      readers.clear();
+      heap.clear();
+      last = 0;
+    }
+  public:
+    SpillRunMerger(const WordDataBuilders & builders, const Language * l)
+      : last(0), greater(l), failed_(false) 
+    {
+      for (unsigned i = 0; i != builders.size(); ++i)
+        runs.insert(runs.end(), 
+                    builders[i]->runs.begin(), builders[i]->runs.end());
+    }
+    ~SpillRunMerger() {clear();}
+    void reset();
+    const WordData * next();
+    bool failed() const {return failed_;}
+  };
+
+  void SpillRunMerger::reset()
+  {
+    clear();
+    for (unsigned i = 0; i != runs.size(); ++i) {
+      SpillRunReader * r = new SpillRunReader(runs[i]);
+      readers.push_back(r);
+      if (r->adv()) heap.push_back(r);
+      else if (r->failed) failed_ = true;
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+  }
+
+  const WordData * SpillRunMerger::next()
+  {
+    if (last) {
+      if (last->adv()) {
+        heap.push_back(last);
+        std::push_heap(heap.begin(), heap.end(), greater);
+      } else if (last->failed) {
+        failed_ = true;
+      }
+      last = 0;
+    }
+    if (heap.empty()) return 0;
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    last = heap.back();
+    heap.pop_back();
+    return last->cur;
+  }
+
+  static WordData * copy_word_data(const WordData * w, ObjStack & buf)
+  {
+    WordData * c = (WordData *)buf.alloc(WordData::struct_size 
+                                         + w->word_size + 1,
+                                         sizeof(void *));
+    memcpy(c, w, WordData::struct_size);
+    memcpy(c->word, w->word, w->word_size + 1);
+    c->next = 0;
+    c->aff = w->aff ? buf.dup(w->aff) : 0;
+    c->sl = w->sl == w->word ? c->word : buf.dup(w->sl);
+    return c;
+  }
+
+  //
+  // Merges words which are the same and marks words that only differ
+  // in case.  Also counts the number of entries.
+  //
+
+  class UniqueWordData {
+    WordDataSource & src;
+    InsensitiveEqual ieq;
+    ObjStack buf[2];
+    int which;
+    WordData * pending;
+  public:
+    int num_entries;
+    int uniq_entries;
+    UniqueWordData(WordDataSource & s, const Language & lang)
+      : src(s), ieq(&lang), which(0), pending(0), 
+        num_entries(0), uniq_entries(0)
+    {
+      src.reset();
+      const WordData * w = src.next();
+      if (w) pending = copy_word_data(w, buf[which]);
+    }
+    const WordData * next();
+  };
+
+  const WordData * UniqueWordData::next()
+  {
+    WordData * prev = pending;
+    if (!prev) return 0;
+    for (;;) {
+      const WordData * cur = src.next();
+      if (!cur) {
+        pending = 0;
+        return prev;
+      }
+      if (strcmp(prev->word, cur->word) == 0) {
+        if (cur->freq > prev->freq) prev->freq = cur->freq;
+        // merge affix info if necessary
+        if (!prev->aff && cur->aff) {
+          prev->flags |= HAVE_AFFIX_FLAG;
+          prev->aff = buf[which].dup(cur->aff);
+          prev->data_size += strlen(prev->aff) + 1;
+        } else if (prev->aff && cur->aff) {
+          unsigned l1 = strlen(prev->aff);
+          unsigned l2 = strlen(cur->aff);
+          char * aff = (char *)buf[which].alloc(l1 + l2 + 1);
+          memcpy(aff, prev->aff, l1);
+          prev->aff = aff;
+          aff += l1;
+          for (const char * p = cur->aff; *p; ++p) {
+            if (memchr(prev->aff, *p, l1)) continue;
+            *aff = *p;
+            ++aff;
+          }
+          *aff = '\0';
+          prev->data_size = prev->word_size + (aff - prev->aff) + 2;
+        }
+      } else {
+        if (ieq(prev->word, cur->word)) prev->flags |= DUPLICATE_FLAG;
+        else ++uniq_entries;
+        ++num_entries;
+        which = !which;
+        buf[which].reset();
+        pending = copy_word_data(cur, buf[which]);
+        return prev;
+      }
+    }
+  }
+
+  //
+  // Decides where each group of words with the same soundslike
+  // starts.  A group can be at most 255 bytes.
+  //
+
+  class SoundslikeGroups {
+    String sl;
+    unsigned size;
+    unsigned word_head;
+  public:
+    SoundslikeGroups(unsigned wh) : size(0), word_head(wh) {}
+    bool starts_group(const WordData * w) {
+      bool res = (size == 0 || strcmp(sl.str(), w->sl) != 0 
+                  || size + word_head + w->data_size >= 255);
+      if (res) {
+        sl.assign(w->sl, w->sl_size);
+        size = 2 + w->sl_size + 1;
+      }
+      size += word_head + w->data_size;
+      return res;
+    }
+  };
+
+  // Returns the size of the prefix a front coded soundslike shares
+  // with prev.  It is 0 when a new jump2 group starts since decoding
+  // starts there.
+  static unsigned front_shared(const String & prev, 
+                               const char * sl, unsigned sl_size)
+  {
+    if (strncmp(prev.str(), sl, 3) != 0) return 0;
+    unsigned max = prev.size() < sl_size ? prev.size() : sl_size;
+    unsigned i = 0;
+    while (i < max && prev[i] == sl[i]) ++i;
+    return i;
+  }
+
   PosibErr<void> create (StringEnumeration * els,
 			 const Language & lang,
                          Config & config) 
   {
     assert(sizeof(u16int) == 2);
     assert(sizeof(u32int) == 4);
+    assert(sizeof(HashBucket) == 64);
 
     bool full_soundslike = !(strcmp(lang.soundslike_name(), "none") == 0 ||
                              strcmp(lang.soundslike_name(), "stripped") == 0 ||
@@ -846,6 +2650,10 @@ namespace {
                              !full_soundslike &&
                              config.retrieve_bool("partially-expand"));
 
+    bool perfect_hash = config.retrieve_bool("perfect-hash");
+    bool bloom_filter = config.retrieve_bool("bloom-filter");
+    bool bucket_hash  = config.retrieve_bool("bucket-hash");
+
     bool invisible_soundslike = false;
     if (partially_expand)
       invisible_soundslike = true;
@@ -854,6 +2662,42 @@ namespace {
     else if (!full_soundslike)
       invisible_soundslike = true;
 
+    // there is nothing to index if the soundslike is not stored
+    bool soundslike_index = (!invisible_soundslike &&
+                             config.retrieve_bool("soundslike-index"));
+
+    // when partially expanding the suggestion code scans the expanded
+    // forms of each word, which are not in the index
+    bool deletion_index = (!partially_expand &&
+                           config.retrieve_bool("deletion-index"));
+
+    // the hash tables and indexes other than the bloom filter store
+    // 32 bit offsets
+    bool large_offsets = config.retrieve_bool("large-offsets");
+    if (large_offsets && (perfect_hash || bucket_hash 
+                          || soundslike_index || deletion_index))
+      return make_err(other_error, 
+                      _("The large-offsets option can not be combined with the perfect-hash, bucket-hash, soundslike-index or deletion-index options."));
+
+    // the soundslike strings are decoded while scanning so the
+    // indexes which point into the middle of a jump2 group can not
+    // be used
+    bool front_code = config.retrieve_bool("front-code");
+    if (front_code && invisible_soundslike)
+      return make_err(other_error, 
+                      _("The front-code option can only be used when the soundslike is stored."));
+    if (front_code && (bucket_hash || large_offsets 
+                       || soundslike_index || deletion_index))
+      return make_err(other_error, 
+                      _("The front-code option can not be combined with the bucket-hash, large-offsets, soundslike-index or deletion-index options."));
+
+    // the frequency is only stored in the rowl 1.14 layout
+    bool word_freq = config.retrieve_bool("word-frequency");
+    if (word_freq && (bucket_hash || large_offsets || front_code))
+      return make_err(other_error, 
+                      _("The word-frequency option can not be combined with the bucket-hash, large-offsets or front-code options."));
+    const int word_head = word_freq ? 4 : 3;
+
     ConvEC iconv;
     if (!config.have("norm-strict"))
       config.replace("norm-strict", "true");
@@ -866,9 +2710,13 @@ namespace {
 
     String base = config.retrieve("master-path");
 
-    DataHead data_head;
+    LargeDataHead data_head;
     memset(&data_head, 0, sizeof(data_head));
-    strcpy(data_head.check_word, cur_check_word);
+    strcpy(data_head.check_word, 
+           large_offsets ? large_check_word :
+           bucket_hash   ? bucket_check_word : 
+           front_code    ? front_check_word  : 
+           word_freq     ? freq_check_word   : cur_check_word);
 
     data_head.endian_check = 12345678;
 
@@ -876,16 +2724,21 @@ namespace {
     data_head.lang_name_size = strlen(lang.name()) + 1;
     data_head.soundslike_name_size    = strlen(lang.soundslike_name()) + 1;
     data_head.soundslike_version_size = strlen(lang.soundslike_version()) + 1;
-    data_head.head_size  = sizeof(DataHead);
+    data_head.head_size  = large_offsets ? sizeof(LargeDataHead) : sizeof(DataHead);
     data_head.head_size += data_head.dict_name_size;
     data_head.head_size += data_head.lang_name_size;
     data_head.head_size += data_head.soundslike_name_size;
     data_head.head_size += data_head.soundslike_version_size;
+    data_head.section_count = (perfect_hash + bloom_filter + soundslike_index
+                               + deletion_index);
+    data_head.head_size += data_head.section_count 
+      * (large_offsets ? sizeof(LargeSectionHead) : sizeof(SectionHead));
     data_head.head_size  = round_up(data_head.head_size, DataHead::align);
 
     data_head.affix_info = affix_compress ? partially_expand ? 1 : 2 : 0;
     data_head.invisible_soundslike = invisible_soundslike;
     data_head.soundslike_root_only = affix_compress  && !partially_expand ? 1 : 0;
+    data_head.freq_info = word_freq;
 
 #if 0
     CERR.printl("FLAGS:  ");
@@ -899,203 +2752,175 @@ namespace {
     
     String temp;
 
-    int num_entries = 0;
-    int uniq_entries = 0;
-    
-    ObjStack buf(16*1024);
-    String sl_buf;
-
     WordData * first = 0;
 
     //
     // Read in Wordlist
     //
+    int num_threads = config.retrieve_int("create-threads");
+#ifdef USE_POSIX_MUTEX
+#  ifdef _SC_NPROCESSORS_ONLN
+    if (num_threads <= 0) num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+#  endif
+#else
+    num_threads = 1;
+#endif
+    if (num_threads <= 0) num_threads = 1;
+    int create_memory = config.retrieve_int("create-memory");
+    size_t mem_limit = create_memory > 0 
+      ? (size_t)create_memory * 1024 * 1024 / num_threads : 0;
+    WordDataBuilders builders;
+    for (int i = 0; i != num_threads; ++i)
+      builders.push_back(new WordDataBuilder(lang, affix_compress, 
+                                             partially_expand, mem_limit));
     {
       WordListIterator wl_itr(els, &lang, config.retrieve_bool("warn") ? &CERR : 0);
       wl_itr.init(config);
-      ObjStack exp_buf;
-      WordAff * exp_list;
-      WordAff single;
-      single.next = 0;
-      Vector<WordAff> af_list;
-      WordData * * prev = &first;
-
-      for (;;) {
-
-        PosibErr<bool> pe = wl_itr.adv();
-        if (pe.has_err()) return pe;
-        if (!pe.data) break;
-
-        const char * w = wl_itr->word.str;
-        unsigned int s = wl_itr->word.size;
-
-        const char * affixes = wl_itr->aff.str;
-
-        if (*affixes && !lang.affix())
-          return make_err(other_error, 
-                          _("Affix flags found in word but no affix file given."));
-
-        if (*affixes && !affix_compress) {
-          exp_buf.reset();
-          exp_list = lang.affix()->expand(w, affixes, exp_buf);
-        } else if (*affixes && partially_expand) {
-          // expand any affixes which will effect the first
-          // 3 letters of a word.  This is needed so that the
-          // jump tables will function correctly
-          exp_buf.reset();
-          exp_list = lang.affix()->expand(w, affixes, exp_buf, 3);
-        } else {
-          single.word.str = w;
-          single.word.size = strlen(w);
-          single.aff = (const byte *)affixes;
-          exp_list = &single;
-        }
+      u32int seq = 0;
 
-        // iterate through each expanded word
-        
-        for (WordAff * p = exp_list; p; p = p->next)
-        {
-          const char * w = p->word.str;
-          s = p->word.size;
-          
-          unsigned total_size = WordData::struct_size;
-          unsigned data_size = s + 1;
-          unsigned aff_size = strlen((const char *)p->aff);
-          if (aff_size > 0) data_size += aff_size + 1;
-          total_size += data_size;
-          lang.to_soundslike(sl_buf, w);
-          const char * sl = sl_buf.str();
-          unsigned sl_size = sl_buf.size();
-          if (strcmp(sl,w) == 0) sl = w;
-          if (sl != w) total_size += sl_size + 1;
-
-          if (total_size - WordData::struct_size > 240)
-            return make_err(invalid_word, MsgConv(lang)(w),
-                            _("The total word length, with soundslike data, is larger than 240 characters."));
-
-          WordData * b = (WordData *)buf.alloc(total_size, sizeof(void *));
-          *prev = b;
-          b->next = 0;
-          prev = &b->next;
-          
-          b->word_size = s;
-          b->sl_size = strlen(sl);
-          b->data_size = data_size;
-          b->flags = lang.get_word_info(w);
+      if (num_threads == 1) {
 
-          char * z = b->word;
+        for (;;) {
+          PosibErr<bool> pe = wl_itr.adv();
+          if (pe.has_err()) return pe;
+          if (!pe.data) break;
+          RET_ON_ERR(builders[0]->add(wl_itr->word.str, wl_itr->aff.str, seq++,
+                                      wl_itr->freq));
+        }
 
-          memcpy(z, w, s + 1);
-          z += s + 1;
+      } else {
 
-          if (aff_size > 0) {
-            b->flags |= HAVE_AFFIX_FLAG;
-            b->aff = z;
-            memcpy(z, p->aff, aff_size + 1);
-            z += aff_size + 1;
-          } else {
-            b->aff = 0;
+        // read the words in batches and divide each batch among the
+        // builders, since the builders keep the order of the words
+        // the result is the same as with a single builder
+        const unsigned batch_size = 8192 * num_threads;
+        Vector<BatchWord> batch;
+        ObjStack batch_buf(64*1024);
+        Vector<WordDataTask> tasks(num_threads);
+        for (;;) {
+          batch.clear();
+          batch_buf.reset();
+          PosibErr<bool> pe;
+          while (batch.size() < batch_size) {
+            pe = wl_itr.adv();
+            if (pe.has_err() || !pe.data) break;
+            BatchWord bw;
+            bw.word = batch_buf.dup(wl_itr->word.str);
+            bw.aff  = batch_buf.dup(wl_itr->aff.str);
+            bw.seq  = seq++;
+            bw.freq = wl_itr->freq;
+            batch.push_back(bw);
           }
-
-          if (sl != w) {
-            memcpy(z, sl, sl_size + 1);
-            b->sl = z;
-          } else {
-            b->sl = b->word;
+          unsigned per_task = (batch.size() + num_threads - 1) / num_threads;
+          for (int i = 0; i != num_threads; ++i) {
+            tasks[i].builder = builders[i];
+            tasks[i].begin = batch.pbegin() + std::min<size_t>(i * per_task, batch.size());
+            tasks[i].end   = batch.pbegin() + std::min<size_t>((i + 1) * per_task, batch.size());
+            tasks[i].err   = no_err;
           }
-
+          run_tasks(tasks.pbegin(), tasks.pend());
+          for (int i = 0; i != num_threads; ++i)
+            if (tasks[i].err.has_err()) return tasks[i].err;
+          if (pe.has_err()) return pe;
+          if (!pe.data) break;
         }
+
       }
       delete els;
     }
 
-    //
-    // sort WordData linked list based on (sl, word)
-    //
+    bool spilled = false;
+    for (int i = 0; i != num_threads; ++i)
+      if (!builders[i]->runs.empty()) spilled = true;
 
-    first = sort(first, SoundslikeLess(&lang));
+    StackPtr<WordDataSource> words;
 
-    //
-    // duplicate check
-    // 
-    WordData * prev = first;
-    WordData * cur = first ? first->next : 0;
-    InsensitiveEqual ieq(&lang);
-    while (cur) {
-      if (strcmp(prev->word, cur->word) == 0) {
-        // merge affix info if necessary
-        if (!prev->aff && cur->aff) {
-          prev->flags |= HAVE_AFFIX_FLAG;
-          prev->aff = cur->aff;
-          prev->data_size += strlen(prev->aff) + 1;
-        } else if (prev->aff && cur->aff) {
-          unsigned l1 = strlen(prev->aff);
-          unsigned l2 = strlen(cur->aff);
-          char * aff = (char *)buf.alloc(l1 + l2 + 1);
-          memcpy(aff, prev->aff, l1);
-          prev->aff = aff;
-          aff += l1;
-          for (const char * p = cur->aff; *p; ++p) {
-            if (memchr(prev->aff, *p, l1)) continue;
-            *aff = *p;
-            ++aff;
-          }
-          *aff = '\0';
-          prev->data_size = prev->word_size + (aff - prev->aff) + 2;
-        }
-        prev->next = cur->next;
-      } else {
-        if (ieq(prev->word, cur->word)) prev->flags |= DUPLICATE_FLAG;
-        else ++uniq_entries;
-        ++num_entries;
-        prev = cur;
-      }
-      cur = cur->next;
-    }
+    if (spilled) {
 
-    //
-    //
-    //
+      //
+      // write out what is left and merge the sorted runs
+      //
 
-    unsigned data_size = 16;
-    WordData * p = first;
-    if (invisible_soundslike) {
-      
-      for (; p; p = p->next)
-        data_size += 3 + p->data_size;
+      Vector<WordDataSpillTask> tasks(num_threads);
+      for (int i = 0; i != num_threads; ++i)
+        tasks[i].builder = builders[i];
+      run_tasks(tasks.pbegin(), tasks.pend());
+      for (int i = 0; i != num_threads; ++i)
+        if (tasks[i].err.has_err()) return tasks[i].err;
+      words.reset(new SpillRunMerger(builders, &lang));
 
     } else {
 
-      while (p)
-      {
-        unsigned ds = 2 + p->sl_size + 1;
+      //
+      // sort WordData linked list based on (sl, word)
+      //
 
-        char * prev = p->sl;
+      {
+        Vector<WordDataSortTask> tasks(num_threads);
+        for (int i = 0; i != num_threads; ++i) {
+          tasks[i].first = builders[i]->first;
+          tasks[i].less  = &lang;
+        }
+        run_tasks(tasks.pbegin(), tasks.pend());
+        first = tasks[0].first;
+        for (int i = 1; i != num_threads; ++i) {
+          if (!first) first = tasks[i].first;
+          else if (tasks[i].first) 
+            first = merge(first, tasks[i].first, SoundslikeLess(&lang), 
+                          Next<WordData>());
+        }
+      }
 
-        do {
-          
-          ds += 3 + p->data_size;
-          p->sl = prev;
-          p = p->next;
+      words.reset(new WordDataList(first));
 
-        } while (p && strcmp(prev, p->sl) == 0 && ds + 3 + p->data_size < 255);
+    }
 
-        data_size += ds;
+    //
+    // duplicate check and size of the data block, the words are
+    // read again when creating the data block
+    //
 
+    int num_entries;
+    int uniq_entries;
+    u64int data_size = 16;
+    {
+      UniqueWordData uniq(*words, lang);
+      SoundslikeGroups groups(word_head);
+      String prev_sl;
+      while (const WordData * p = uniq.next()) {
+        if (!invisible_soundslike && groups.starts_group(p)) {
+          if (front_code) {
+            data_size += 3 + p->sl_size 
+              - front_shared(prev_sl, p->sl, p->sl_size) + 1;
+            prev_sl.assign(p->sl, p->sl_size);
+          } else {
+            data_size += 2 + p->sl_size + 1;
+          }
+        }
+        data_size += word_head + p->data_size;
       }
-
+      if (words->failed())
+        return make_err(cant_read_file, _("a temporary file"));
+      num_entries = uniq.num_entries;
+      uniq_entries = uniq.uniq_entries;
     }
 
+    if (!large_offsets && data_size > u32int_max)
+      return make_err(other_error, 
+                      _("The dictionary is larger than 4 GiB, use the large-offsets option."));
+
     //
     // Create the final data structures
     //
 
     CharVector     data;
+    // the lookup table refers to the data block while it is being
+    // filled in so it must not be reallocated
     data.reserve(data_size);
     data.write32(0); // to avoid nasty special cases
-    unsigned int prev_pos = data.size();
+    size_t prev_pos = data.size();
     data.write32(0);
-    unsigned prev_w_pos = data.size();
+    size_t prev_w_pos = data.size();
 
     WordLookup lookup(affix_compress 
                       ? uniq_entries * 3 / 2 
@@ -1104,92 +2929,119 @@ namespace {
     lookup.parms().hash .lang     = &lang;
     lookup.parms().equal.cmp.lang = &lang;
 
-    Vector<Jump> jump1;
-    Vector<Jump> jump2;
+    Vector<LargeJump> jump1;
+    Vector<LargeJump> jump2;
 
-    const int head_size = invisible_soundslike ? 3 : 2;
+    Vector<const char *> sls;
+    Vector<u32int> sl_offsets;
+    ObjStack sl_buf;
 
-    const char * prev_sl = "";
-    p = first;
-    while (p)
+    const int head_size = invisible_soundslike ? word_head : front_code ? 3 : 2;
+
+    String prev_sl;
+    UniqueWordData uniq(*words, lang);
+    SoundslikeGroups groups(word_head);
+    while (const WordData * p = uniq.next())
     {
-      if (invisible_soundslike) {
+      if (invisible_soundslike || groups.starts_group(p)) {
 
-        data.write(p->flags); // flags  
-        data.write('\0'); // place holder for offset to next item
-        data.write(p->word_size);
+        unsigned shared = 0;
 
-      } else {
+        if (invisible_soundslike) {
+
+          if (word_freq) data.write(p->freq);
+          data.write(p->flags | (word_freq ? HAVE_FREQUENCY_FLAG : 0)); // flags  
+          data.write('\0'); // place holder for offset to next item
+          data.write(p->word_size);
 
-        data.write('\0'); // place holder for offset to next item
-        data.write(p->sl_size);
+        } else if (front_code) {
 
-      }
+          shared = front_shared(prev_sl, p->sl, p->sl_size);
+          data.write(shared);
+          data.write('\0'); // place holder for offset to next item
+          data.write(p->sl_size - shared);
+
+        } else {
+
+          data.write('\0'); // place holder for offset to next item
+          data.write(p->sl_size);
+
+        }
         
-      if (strncmp(prev_sl, p->sl, 3) != 0) {
+        if (strncmp(prev_sl.str(), p->sl, 3) != 0) {
         
-        Jump jump;
-        strncpy(jump.sl, p->sl, 3);
-        jump.loc = data.size();
-        jump2.push_back(jump);
+          LargeJump jump;
+          strncpy(jump.sl, p->sl, 3);
+          jump.loc = data.size();
+          jump2.push_back(jump);
         
-        if (strncmp(prev_sl, p->sl, 2) != 0) {
-          Jump jump;
-          strncpy(jump.sl, p->sl, 2);
-          jump.loc = jump2.size() - 1;
-          jump1.push_back(jump);
-        }
+          if (strncmp(prev_sl.str(), p->sl, 2) != 0) {
+            LargeJump jump;
+            strncpy(jump.sl, p->sl, 2);
+            jump.loc = jump2.size() - 1;
+            jump1.push_back(jump);
+          }
 
-        data[prev_pos - NEXT_O] = (byte)(data.size() - prev_pos - head_size + 1);
-        // when advanced to this position the offset byte will
-        // be null (since it will point to the null terminator
-        // of the last word) and will thus signal the end of the
-        // group
+          data[prev_pos - NEXT_O] = (byte)(data.size() - prev_pos - head_size + 1);
+          // when advanced to this position the offset byte will
+          // be null (since it will point to the null terminator
+          // of the last word) and will thus signal the end of the
+          // group
         
-      } else {
+        } else {
         
-        data[prev_pos - NEXT_O] = (byte)(data.size() - prev_pos);
+          data[prev_pos - NEXT_O] = (byte)(data.size() - prev_pos);
         
-      }
+        }
         
-      prev_pos = data.size();
-      prev_sl = p->sl;
+        prev_pos = data.size();
+        prev_sl.assign(p->sl, p->sl_size);
 
-      if (invisible_soundslike) {
+        if (invisible_soundslike) {
         
-        unsigned pos = data.size();
-        prev_w_pos = data.size();
-        data.write(p->word, p->word_size + 1);
-        if (p->aff) data.write(p->aff, p->data_size - p->word_size - 1);
-        lookup.insert(pos);
-
-        p = p->next;
-
-      } else {
-
-        data.write(p->sl, p->sl_size + 1);
-
-        // write all word entries with the same soundslike
-
-        do {
-          data.write(p->flags);
-          data.write(p->data_size + 3);
-          data.write(p->word_size);
-
-          unsigned pos = data.size();
-          data[prev_w_pos - NEXT_O] = (byte)(pos - prev_w_pos);
+          size_t pos = data.size();
+          prev_w_pos = data.size();
+          if (deletion_index) {
+            sls.push_back(sl_buf.dup(p->sl));
+            sl_offsets.push_back(pos);
+          }
           data.write(p->word, p->word_size + 1);
           if (p->aff) data.write(p->aff, p->data_size - p->word_size - 1);
           lookup.insert(pos);
 
-          prev_w_pos = pos;
-          prev_sl = p->sl;
+          continue;
+
+        } 
 
-          p = p->next;
+        // the soundslike is written once for all the words in the
+        // group, the word entries follow
+        if (soundslike_index || deletion_index)
+          sl_offsets.push_back(data.size());
+        data.write(p->sl + shared, p->sl_size - shared + 1);
 
-        } while (p && prev_sl == p->sl); // yes I really mean to use pointer compare here
       }
+
+      if (word_freq) data.write(p->freq);
+      data.write(p->flags | (word_freq ? HAVE_FREQUENCY_FLAG : 0));
+      data.write(p->data_size + word_head);
+      data.write(p->word_size);
+
+      size_t pos = data.size();
+      data[prev_w_pos - NEXT_O] = (byte)(pos - prev_w_pos);
+      data.write(p->word, p->word_size + 1);
+      if (p->aff) data.write(p->aff, p->data_size - p->word_size - 1);
+      lookup.insert(pos);
+
+      prev_w_pos = pos;
     }
+    if (words->failed())
+      return make_err(cant_read_file, _("a temporary file"));
+    words.del();
+    builders.clear();
+
+    if (!invisible_soundslike)
+      for (unsigned i = 0; i != sl_offsets.size(); ++i)
+        sls.push_back(data.data() + sl_offsets[i]);
 
     // add special end case
     if (data.size() % 2 != 0) data.write('\0');
@@ -1197,8 +3049,8 @@ namespace {
     data.write16(0);
     data[prev_pos - NEXT_O] |= (byte)(data.size() - prev_pos);
     
-    jump2.push_back(Jump());
-    jump1.push_back(Jump());
+    jump2.push_back(LargeJump());
+    jump1.push_back(LargeJump());
     
     data.write(0);
     data.write(0);
@@ -1224,34 +3076,130 @@ namespace {
 
     // Write jump1 table
     data_head.jump1_offset = out.tell() - data_head.head_size;
-    out.write(jump1.data(), jump1.size() * sizeof(Jump));
+    if (large_offsets) write_jumps<LargeJump>(out, jump1);
+    else               write_jumps<Jump>(out, jump1);
     
     // Write jump2 table
     advance_file(out, round_up(out.tell(), DataHead::align));
     data_head.jump2_offset = out.tell() - data_head.head_size;
-    out.write(jump2.data(), jump2.size() * sizeof(Jump));
+    if (large_offsets) write_jumps<LargeJump>(out, jump2);
+    else               write_jumps<Jump>(out, jump2);
 
     // Write data block
     advance_file(out, round_up(out.tell(), DataHead::align));
     data_head.word_offset = out.tell() - data_head.head_size;
-    out.write(data.data(), data.size());
+    write_block(out, data.data(), data.size());
 
     // Write hash
-    advance_file(out, round_up(out.tell(), DataHead::align));
-    data_head.hash_offset = out.tell() - data_head.head_size;
-    out.write(&lookup.vector().front(), lookup.vector().size() * 4);
+    if (bucket_hash) {
+      // align the buckets to a cache line
+      advance_file(out, round_up(out.tell(), sizeof(HashBucket)));
+      data_head.hash_offset = out.tell() - data_head.head_size;
+      data_head.word_buckets = write_bucket_hash(out, lookup, data.data(), lang);
+    } else {
+      advance_file(out, round_up(out.tell(), DataHead::align));
+      data_head.hash_offset = out.tell() - data_head.head_size;
+      const WordLookup::vector_type & table = lookup.vector();
+      if (large_offsets) {
+        write_block(out, (const char *)table.data(), table.size() * 8);
+      } else {
+        Vector<u32int> small_table(table.size());
+        for (unsigned i = 0; i != table.size(); ++i)
+          small_table[i] = table[i] == u64int_max ? u32int_max : table[i];
+        write_block(out, (const char *)small_table.data(), 
+                    small_table.size() * 4);
+      }
+    }
+
+    // Write optional sections
+    Vector<LargeSectionHead> sections;
+    LargeSectionHead sec;
+    u32int seed = 0;
+    if (perfect_hash) {
+      advance_file(out, round_up(out.tell(), DataHead::align));
+      sec.id = PERFECT_HASH_SECTION;
+      sec.version = 1;
+      sec.offset = out.tell() - data_head.head_size;
+      seed = write_perfect_hash(out, lookup, data.data(), lang);
+      sec.size = out.tell() - data_head.head_size - sec.offset;
+      sections.push_back(sec);
+    }
+    if (soundslike_index) {
+      advance_file(out, round_up(out.tell(), DataHead::align));
+      sec.id = SOUNDSLIKE_INDEX_SECTION;
+      sec.version = 1;
+      sec.offset = out.tell() - data_head.head_size;
+      write_soundslike_index(out, sls, sl_offsets);
+      sec.size = out.tell() - data_head.head_size - sec.offset;
+      sections.push_back(sec);
+    }
+    if (deletion_index) {
+      advance_file(out, round_up(out.tell(), DataHead::align));
+      sec.id = DELETION_INDEX_SECTION;
+      sec.version = 1;
+      sec.offset = out.tell() - data_head.head_size;
+      write_deletion_index(out, sls, sl_offsets);
+      sec.size = out.tell() - data_head.head_size - sec.offset;
+      sections.push_back(sec);
+    }
+    if (bloom_filter) {
+      // use the same seed as the perfect hash so that a lookup
+      // only needs to hash the word once
+      advance_file(out, round_up(out.tell(), DataHead::align));
+      sec.id = BLOOM_FILTER_SECTION;
+      sec.version = 1;
+      sec.offset = out.tell() - data_head.head_size;
+      write_bloom_filter(out, lookup, data.data(), lang, seed);
+      sec.size = out.tell() - data_head.head_size - sec.offset;
+      sections.push_back(sec);
+    }
+    assert(sections.size() == data_head.section_count);
     
     // calculate block size
     advance_file(out, round_up(out.tell(), DataHead::align));
     data_head.block_size = out.tell() - data_head.head_size;
 
-    // write data head to file
+    if (!large_offsets && data_head.block_size > u32int_max)
+      return make_err(other_error, 
+                      _("The dictionary is larger than 4 GiB, use the large-offsets option."));
+
+    // write data head to file, it is assembled in memory first so
+    // that the checksum can be computed
+    HeadFingerprint fp;
+    fingerprint(&lang, fp);
+    memcpy(data_head.lang_hash, &fp, sizeof(fp));
+    CharVector head;
+    if (large_offsets) {
+      head.append(&data_head, sizeof(LargeDataHead));
+    } else {
+      DataHead small_head;
+      memset(&small_head, 0, sizeof(small_head));
+      convert_head(data_head, small_head);
+      head.append(&small_head, sizeof(DataHead));
+    }
+    head.append(" ", 1);
+    head.append(lang.name(), data_head.lang_name_size);
+    head.append(lang.soundslike_name(), data_head.soundslike_name_size);
+    head.append(lang.soundslike_version(), data_head.soundslike_version_size);
+    if (large_offsets) {
+      if (!sections.empty())
+        head.append(sections.data(), sections.size() * sizeof(LargeSectionHead));
+    } else {
+      for (unsigned i = 0; i != sections.size(); ++i) {
+        SectionHead small_sec;
+        small_sec.id      = sections[i].id;
+        small_sec.version = sections[i].version;
+        small_sec.offset  = sections[i].offset;
+        small_sec.size    = sections[i].size;
+        head.append(&small_sec, sizeof(SectionHead));
+      }
+    }
+    assert(head.size() <= data_head.head_size);
+    head.resize(data_head.head_size, '\0');
+    fp.head_sum = head_checksum(head.data(), head.size());
+    memcpy(head.data() + offsetof(DataHead, lang_hash), &fp, sizeof(fp));
     out.seek(0);
-    out.write(&data_head, sizeof(DataHead));
-    out.write(" ", 1);
-    out.write(lang.name(), data_head.lang_name_size);
-    out.write(lang.soundslike_name(), data_head.soundslike_name_size);
-    out.write(lang.soundslike_version(), data_head.soundslike_version_size);
+    out.write(head.data(), head.size());
 
     return no_err;
   }
@@ -4,7 +4,9 @@
 // LGPL license along with this library if you did not you can find it
 // at http://www.gnu.org/.
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <typeinfo>
 
 #include "clone_ptr-t.hpp"
@@ -15,11 +17,14 @@
 #include "language.hpp"
 #include "speller_impl.hpp"
 #include "string_list.hpp"
+#include "string_pair_enumeration.hpp"
 #include "suggest.hpp"
 #include "tokenizer.hpp"
 #include "convert.hpp"
 #include "stack_ptr.hpp"
 #include "istream_enumeration.hpp"
+#include "lock.hpp"
+#include "vararray.hpp"
 
 //#include "iostream.hpp"
 
@@ -45,6 +50,35 @@ namespace aspeller {
     return str;
   }
 
+  //////////////////////////////////////////////////////////////////////
+  //
+  // Suggestion cache generations
+  //
+
+  static Mutex generation_lock;
+  static unsigned long last_generation = 0;
+
+  // returns a value not returned before, so that no two spellers or
+  // dictionaries ever have the same non-zero generation
+  static unsigned long new_generation()
+  {
+    LOCK(&generation_lock);
+    return ++last_generation;
+  }
+
+  void SpellerImpl::invalidate_sug_cache()
+  {
+    sug_generation_ = new_generation();
+  }
+
+  void SpellerImpl::sug_cache_key(String & key) const
+  {
+    key.printf("%lu %lu %lu %lu", sug_generation_,
+               personal_ ? personal_->generation : 0,
+               session_ ? session_->generation : 0,
+               repl_ ? repl_->generation : 0);
+  }
+
   //////////////////////////////////////////////////////////////////////
   //
   // Spell check methods
@@ -52,16 +86,22 @@ namespace aspeller {
 
   PosibErr<void> SpellerImpl::add_to_personal(MutableString word) {
     if (!personal_) return no_err;
+    invalidate_check_cache();
+    personal_->generation = new_generation();
     return personal_->add(word);
   }
   
   PosibErr<void> SpellerImpl::add_to_session(MutableString word) {
     if (!session_) return no_err;
+    invalidate_check_cache();
+    session_->generation = new_generation();
     return session_->add(word);
   }
 
   PosibErr<void> SpellerImpl::clear_session() {
     if (!session_) return no_err;
+    invalidate_check_cache();
+    session_->generation = new_generation();
     return session_->clear();
   }
 
@@ -108,6 +148,7 @@ namespace aspeller {
         return no_err;
       if (first_word == 0 || cor != first_word) {
         lang().to_lower(buf, mis.str());
+        repl_->generation = new_generation();
         repl_->add_repl(buf, cor_orignal_casing);
       }
       
@@ -134,7 +175,85 @@ namespace aspeller {
     return &suggest_->suggest(word);
   }
 
-  bool SpellerImpl::check_simple (ParmString w, WordEntry & w0) 
+  PosibErr<const WordList *> SpellerImpl::suggest_within(MutableString word,
+                                                         int usecs)
+  {
+    return &suggest_->suggest(word, usecs > 0 ? usecs : 0);
+  }
+
+  bool SpellerImpl::suggest_timed_out() const
+  {
+    return suggest_->timed_out();
+  }
+
+  PosibErr<const WordList *> SpellerImpl::suggest_begin(MutableString word)
+  {
+    return &suggest_->suggest_begin(word);
+  }
+
+  PosibErr<const WordList *> SpellerImpl::suggest_refine()
+  {
+    return &suggest_->suggest_refine();
+  }
+
+  bool SpellerImpl::suggest_done() const
+  {
+    return suggest_->suggest_done();
+  }
+
+  PosibErr<int> SpellerImpl::suggest_batch(const char * * words,
+                                           const int * sizes, int n)
+  {
+    // convert_batch also rejects a negative n before ws is sized
+    PosibErrBase pe(convert_batch("aspell_speller_suggest_batch", 
+                                  words, sizes, n));
+    if (pe.has_err()) {
+      // so that the suggestions of the last batch are not returned
+      suggest_->suggest_batch(0, 0);
+      return PosibErrBase(pe);
+    }
+    const char * buf = batch_buf_.c_str();
+    Vector<const char *> ws(n);
+    for (int i = 0; i != n; ++i)
+      ws[i] = buf + batch_offsets_[i];
+    suggest_->suggest_batch(ws.pbegin(), n);
+    return n;
+  }
+
+  PosibErr<const WordList *> SpellerImpl::batch_suggestions(int i)
+  {
+    if (i < 0) return 0;
+    return suggest_->batch_suggestions(i);
+  }
+
+  PosibErr<const WordList *> SpellerImpl::suggest(MutableString word,
+                                                  Context & cx) const
+  {
+    // the speller's own Suggest was set up with the config, so copy
+    // it rather than reading the config, which may be in use by
+    // another thread
+    if (!cx.suggest)
+      cx.suggest = suggest_->clone_setup();
+    return &cx.suggest->suggest(word);
+  }
+
+  bool SpellerImpl::check_word(ParmString word) const
+  {
+    size_t sz = word.size();
+    VARARRAY(char, w, sz + 1);
+    memcpy(w, word.str(), sz);
+    w[sz] = '\0';
+    CheckInfo ci[8];
+    return check(w, w + sz, false, run_together_limit(),
+                 ci, ci + 8, NULL);
+  }
+
+  SpellerImpl::Context::~Context()
+  {
+    delete suggest;
+  }
+
+  bool SpellerImpl::check_simple (ParmString w, WordEntry & w0) const
   {
     w0.clear(); // FIXME: is this necessary?
     const char * x = w;
@@ -149,7 +268,7 @@ namespace aspeller {
     return false;
   };
 
-  bool SpellerImpl::check_affix(ParmString word, CheckInfo & ci, GuessInfo * gi)
+  bool SpellerImpl::check_affix(ParmString word, CheckInfo & ci, GuessInfo * gi) const
   {
     WordEntry w;
     bool res = check_simple(word, w);
@@ -166,7 +285,7 @@ namespace aspeller {
 
   inline bool SpellerImpl::check_single(char * word, /* it WILL modify word */
                                         bool try_uppercase,
-                                        CheckInfo & ci, GuessInfo * gi)
+                                        CheckInfo & ci, GuessInfo * gi) const
   {
     bool res = check_affix(word, ci, gi);
     if (res) return true;
@@ -179,12 +298,237 @@ namespace aspeller {
     return false;
   }
 
+  // How many words ahead of the one being checked to prefetch
+  static const int PREFETCH_AHEAD = 4;
+
+  // Converts the words of a batch into batch_buf_, null terminated,
+  // with word i starting at batch_offsets_[i].  The buffer is kept
+  // around for the next batch.
+  PosibErr<void> SpellerImpl::convert_batch(const char * fun,
+                                            const char * * words,
+                                            const int * sizes, int n)
+  {
+    if (n < 0) {
+      char m[100];
+      snprintf(m, 100, _("%s: The number of words, %d, is negative."), fun, n);
+      return make_err(other_error, m);
+    }
+    batch_buf_.clear();
+    batch_offsets_.clear();
+    for (int i = 0; i != n; ++i) {
+      RET_ON_ERR_SET(get_correct_size(fun, to_internal_->in_type_width(),
+                                      sizes ? sizes[i] : -1),
+                     int, size);
+      batch_offsets_.push_back(batch_buf_.size());
+      to_internal_->convert(words[i], size, batch_buf_);
+      batch_buf_.append('\0');
+    }
+    batch_offsets_.push_back(batch_buf_.size());
+    return no_err;
+  }
+
+  PosibErr<int> SpellerImpl::check_batch(const char * * words,
+                                         const int * sizes,
+                                         int n, int * results)
+  {
+    // Convert all the words into a single buffer first, so that the
+    // lookups for the next few words can be started while checking
+    // the current one.  Prefetching hashes each word a second time
+    // for each dictionary, which only pays for itself when the
+    // dictionaries do not fit in the CPU cache.
+    RET_ON_ERR(convert_batch("aspell_speller_check_batch", words, sizes, n));
+
+    char * buf = batch_buf_.mstr();
+    for (int i = 0; i < n && i < PREFETCH_AHEAD; ++i)
+      prefetch(buf + batch_offsets_[i]);
+
+    // no guesses are needed to tell if a word is correct
+    cx_.guess_info.reset();
+    int num_correct = 0;
+    for (int i = 0; i != n; ++i) {
+      if (i + PREFETCH_AHEAD < n)
+        prefetch(buf + batch_offsets_[i + PREFETCH_AHEAD]);
+      char * word = buf + batch_offsets_[i];
+      char * word_end = buf + batch_offsets_[i + 1] - 1;
+      RET_ON_ERR_SET(check_cached(word, word_end, cx_, NULL), bool, res);
+      results[i] = res;
+      num_correct += res;
+    }
+    return num_correct;
+  }
+
+  PosibErr<bool> SpellerImpl::check_cached(char * word, char * word_end,
+                                           Context & cx, GuessInfo * gi) const
+  {
+    if (check_cache_size_ == 0)
+      return check(word, word_end, false, run_together_limit(),
+                   cx.check_inf, cx.check_inf + 8, gi);
+    CheckCache & cache = cx.cache;
+    if (cache.owner != this || cache.capacity != check_cache_size_)
+      cache.reset(this, check_cache_size_);
+    ParmString w(word, word_end - word);
+    bool res;
+    if (cache.lookup(w, check_generation_, res, cx.check_inf, gi))
+      return res;
+    RET_ON_ERR_SET(check(word, word_end, false, run_together_limit(),
+                         cx.check_inf, cx.check_inf + 8, gi),
+                   bool, r);
+    cache.insert(w, check_generation_, r, cx.check_inf, gi);
+    return r;
+  }
+
+  void CheckCache::reset(const void * o, unsigned size)
+  {
+    owner = o;
+    capacity = size;
+    unsigned bits = 0;
+    while ((1u << bits) < size) ++bits;
+    shift = 64 - bits;
+    entries.clear();
+    entries.resize(1u << bits);
+  }
+
+  CheckCache::Entry & CheckCache::slot(ParmString word)
+  {
+    uint64_t h = 0;
+    for (const char * i = word.str(), * end = i + word.size(); i != end; ++i)
+      h = 5*h + (unsigned char)*i;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return entries[shift == 64 ? 0 : (size_t)(h >> shift)];
+  }
+
+  bool CheckCache::lookup(ParmString word, unsigned gen, bool & correct,
+                          CheckInfo * ci, GuessInfo * gi)
+  {
+    Entry & e = slot(word);
+    if (!e.used || e.generation != gen || (gi && !e.have_guesses)
+        || e.word.size() != word.size()
+        || memcmp(e.word.str(), word.str(), word.size()) != 0) {
+      ++misses;
+      return false;
+    }
+    ++hits;
+    correct = e.correct;
+    clear_check_info(ci[0]);
+    for (unsigned i = 0; i != e.num_check; ++i) {
+      const Saved & s = e.infos[i];
+      ci[i] = s.info;
+      if (s.offset >= 0) ci[i].word.str = word.str() + s.offset;
+      if (s.info.next) ci[i].next = ci + i + 1;
+    }
+    if (gi) {
+      // GuessInfo::add prepends so add them in reverse
+      for (unsigned i = e.infos.size(); i != e.num_check; --i) {
+        const Saved & s = e.infos[i - 1];
+        CheckInfo * g = gi->add();
+        const CheckInfo * next = g->next;
+        *g = s.info;
+        g->next = next;
+        g->word.str = gi->dup(ParmString(e.strs.str() + s.offset, s.info.word.len));
+      }
+    }
+    return true;
+  }
+
+  void CheckCache::insert(ParmString word, unsigned gen, bool correct,
+                          const CheckInfo * ci, const GuessInfo * gi)
+  {
+    Entry & e = slot(word);
+    e.used = true;
+    e.generation = gen;
+    e.correct = correct;
+    e.have_guesses = gi;
+    e.word.assign(word.str(), word.size());
+    e.infos.clear();
+    e.strs.clear();
+    Saved s;
+    // the check info either points into the word checked or to data
+    // which lives as long as the generation does
+    if (ci[0].word.str) {
+      for (const CheckInfo * i = ci; i; i = i->next) {
+        s.info = *i;
+        if (i->word.str >= word.str() && i->word.str <= word.str() + word.size())
+          s.offset = i->word.str - word.str();
+        else
+          s.offset = -1;
+        e.infos.push_back(s);
+      }
+    }
+    e.num_check = e.infos.size();
+    // guesses may point to temporary storage so copy them
+    if (gi) {
+      for (const CheckInfo * i = gi->head; i; i = i->next) {
+        s.info = *i;
+        s.offset = e.strs.size();
+        e.strs.append(i->word.str, i->word.len);
+        e.strs.append('\0');
+        e.infos.push_back(s);
+      }
+    }
+  }
+
+  void SpellerImpl::prefetch(const char * word) const
+  {
+    WS::const_iterator i   = check_ws.begin();
+    WS::const_iterator end = check_ws.end();
+    for (; i != end; ++i)
+      (*i)->prefetch(word);
+  }
+
+  //
+  // Run-together words are split with a depth first search which
+  // prefers the whole word, and then the shortest first word for which
+  // the rest can be split.  Whether the rest of the word starting at a
+  // given position can be split only depends on that position, if the
+  // first letter may be uppercase, and how many more words are
+  // allowed.  So, the failures are remembered in a RunTogetherMemo and
+  // no such state is searched more than once, which bounds the work to
+  // O(length^2 * run-together-limit) calls to check_single instead of
+  // being exponential in the limit.
+  //
+
+  class SpellerImpl::RunTogetherMemo {
+  public:
+    // fail_limit must have room for 2 * (w_end - w + 1) entries
+    RunTogetherMemo(const char * w, const char * w_end, unsigned char * fl)
+      : word(w), fail_limit(fl) {memset(fail_limit, 0, 2 * (w_end - w + 1));}
+    // true if the rest of the word starting at pos is known not to
+    // split into at most limit words
+    bool failed(const char * pos, bool try_uppercase, unsigned limit) const {
+      return fail_limit[index(pos, try_uppercase)] >= limit;
+    }
+    void set_failed(const char * pos, bool try_uppercase, unsigned limit) {
+      unsigned char & l = fail_limit[index(pos, try_uppercase)];
+      if (limit > l) l = limit;
+    }
+  private:
+    size_t index(const char * pos, bool try_uppercase) const {
+      return 2 * (pos - word) + try_uppercase;
+    }
+    const char * word;
+    unsigned char * fail_limit;
+  };
+
   CheckInfo * SpellerImpl::check_runtogether(char * word, char * word_end, 
                                              /* it WILL modify word */
                                              bool try_uppercase,
                                              unsigned run_together_limit,
                                              CheckInfo * ci, CheckInfo * ci_end,
-                                             GuessInfo * gi)
+                                             GuessInfo * gi) const
+  {
+    VARARRAY(unsigned char, fail_limit, 2 * (word_end - word + 1));
+    RunTogetherMemo memo(word, word_end, fail_limit);
+    return check_runtogether(word, word_end, try_uppercase, run_together_limit,
+                             ci, ci_end, gi, memo);
+  }
+
+  CheckInfo * SpellerImpl::check_runtogether(char * word, char * word_end, 
+                                             /* it WILL modify word */
+                                             bool try_uppercase,
+                                             unsigned run_together_limit,
+                                             CheckInfo * ci, CheckInfo * ci_end,
+                                             GuessInfo * gi,
+                                             RunTogetherMemo & memo) const
   {
     if (ci >= ci_end) return NULL;
     clear_check_info(*ci);
@@ -204,12 +548,14 @@ namespace aspeller {
       if (is_title == Unknown)
         is_title = lang_->case_pattern(word) == FirstUpper ? Yes : No;
       *i = t;
-      CheckInfo * ci_last = check_runtogether(i, word_end, is_title == Yes, run_together_limit - 1, ci + 1, ci_end, 0);
+      if (memo.failed(i, is_title == Yes, run_together_limit - 1)) continue;
+      CheckInfo * ci_last = check_runtogether(i, word_end, is_title == Yes, run_together_limit - 1, ci + 1, ci_end, 0, memo);
       if (ci_last) {
         ci->compound = true;
         ci->next = ci + 1;
         return ci_last;
       }
+      memo.set_failed(i, is_title == Yes, run_together_limit - 1);
     }
     return NULL;
   }
@@ -219,7 +565,7 @@ namespace aspeller {
                                     bool try_uppercase,
                                     unsigned run_together_limit,
                                     CheckInfo * ci, CheckInfo * ci_end,
-                                    GuessInfo * gi, CompoundInfo * cpi)
+                                    GuessInfo * gi, CompoundInfo * cpi) const
   {
     clear_check_info(*ci);
     bool res = check_runtogether(word, word_end, try_uppercase, run_together_limit, ci, ci_end, gi);
@@ -319,6 +665,44 @@ namespace aspeller {
     return no_err;
   }
   
+  PosibErr<void> SpellerImpl::warm() {
+    for (SpellerDict * i = dicts_; i; i = i->next)
+      i->dict->warm();
+    return no_err;
+  }
+
+  class DictMemoryEnumeration : public StringPairEnumeration {
+  public:
+    Vector<String> names;
+    Vector<String> usage;
+    unsigned pos;
+    DictMemoryEnumeration() : pos(0) {}
+    bool at_end() const {return pos == names.size();}
+    StringPair next() {
+      if (at_end()) return StringPair();
+      StringPair res(names[pos].str(), usage[pos].str());
+      ++pos;
+      return res;
+    }
+    StringPairEnumeration * clone() const {
+      return new DictMemoryEnumeration(*this);}
+    void assign(const StringPairEnumeration * other) {
+      *this = *static_cast<const DictMemoryEnumeration *>(other);}
+  };
+
+  StringPairEnumeration * SpellerImpl::dict_memory_usage() const {
+    DictMemoryEnumeration * els = new DictMemoryEnumeration;
+    for (const SpellerDict * i = dicts_; i; i = i->next) {
+      size_t size, resident;
+      if (!i->dict->memory_usage(size, resident)) continue;
+      String u;
+      u.printf("%lu %lu", (unsigned long)size, (unsigned long)resident);
+      els->names.push_back(i->dict->file_name());
+      els->usage.push_back(u);
+    }
+    return els;
+  }
+  
   int SpellerImpl::num_wordlists() const {
     return 0; //FIXME
   }
@@ -374,6 +758,8 @@ namespace aspeller {
     wc->next = dicts_;
     dicts_ = wc;
 
+    invalidate_check_cache();
+
     // check if it has a special_id and act accordingly
     switch (wc->special_id) {
     case main_id:
@@ -502,6 +888,18 @@ namespace aspeller {
       m->camel_case_ = value;
       return no_err;
     }
+    static PosibErr<void> check_cache_size(SpellerImpl * m, int value) {
+      m->check_cache_size_ = value > 0 ? value : 0;
+      return no_err;
+    }
+    static PosibErr<void> sug_cache_size(SpellerImpl * m, int value) {
+      m->sug_cache_size_ = value > 0 ? value : 0;
+      return no_err;
+    }
+    static PosibErr<void> sug_deadline_us(SpellerImpl * m, int value) {
+      m->sug_deadline_us_ = value > 0 ? value : 0;
+      return no_err;
+    }
   };
 
   static UpdateMember update_members[] = 
@@ -524,6 +922,15 @@ namespace aspeller {
     ,{"camel-case",
         UpdateMember::Bool,    
         UpdateMember::CN::camel_case}
+    ,{"check-cache-size",
+        UpdateMember::Int,
+        UpdateMember::CN::check_cache_size}
+    ,{"sug-cache-size",
+        UpdateMember::Int,
+        UpdateMember::CN::sug_cache_size}
+    ,{"sug-deadline-us",
+        UpdateMember::Int,
+        UpdateMember::CN::sug_deadline_us}
   };
 
   template <typename T>
@@ -538,6 +945,8 @@ namespace aspeller {
       if (strcmp(ki->name, i->name) == 0) {
         if (i->type == t) {
           RET_ON_ERR(i->fun.call(m, value));
+          m->invalidate_check_cache();
+          m->invalidate_sug_cache();
           break;
         }
       }
@@ -553,7 +962,9 @@ namespace aspeller {
 
   SpellerImpl::SpellerImpl() 
     : Speller(0) /* FIXME */, ignore_repl(true), 
-      dicts_(0), personal_(0), session_(0), repl_(0), main_(0)
+      dicts_(0), personal_(0), session_(0), repl_(0), main_(0),
+      check_cache_size_(0), check_generation_(0),
+      sug_cache_size_(0), sug_deadline_us_(0), sug_generation_(0)
   {}
 
   inline PosibErr<void> add_dicts(SpellerImpl * sp, DictList & d)
@@ -571,29 +982,10 @@ namespace aspeller {
     assert (config_ == 0);
     config_.reset(c);
 
-    ignore_repl = config_->retrieve_bool("ignore-repl");
-    ignore_count = config_->retrieve_int("ignore");
-
     DictList to_add;
     RET_ON_ERR(add_data_set(config_->retrieve("master-path"), *config_, &to_add, this));
     RET_ON_ERR(add_dicts(this, to_add));
 
-    s_cmp.lang = lang_;
-    s_cmp.case_insensitive = config_->retrieve_bool("ignore-case");
-
-    s_cmp_begin.lang = lang_; 
-    s_cmp_begin.case_insensitive = s_cmp.case_insensitive;
-    s_cmp_begin.end = false;
-
-    s_cmp_middle.lang = lang_;
-    s_cmp_middle.case_insensitive = s_cmp.case_insensitive;
-    s_cmp_middle.begin = false;
-    s_cmp_middle.end   = false;
-
-    s_cmp_end.lang = lang_;
-    s_cmp_end.case_insensitive = s_cmp.case_insensitive;
-    s_cmp_end.begin = false;
-
     StringList extra_dicts;
     config_->retrieve_list("extra-dicts", &extra_dicts);
     StringListEnumeration els = extra_dicts.elements_obj();
@@ -603,6 +995,29 @@ namespace aspeller {
       RET_ON_ERR(add_dicts(this, to_add));
     }
 
+    RET_ON_ERR(setup_other_dicts());
+
+    StringList wordlist_files;
+    config_->retrieve_list("wordlists", &wordlist_files);
+    if (!wordlist_files.empty()) {
+      Dictionary * dict = session_;
+      if (!dict) {
+        dict = new_default_writable_dict(*config_);
+        dict->set_check_lang(lang_name(), *config_);
+        RET_ON_ERR(add_dict(new SpellerDict(dict, *config_)));
+      }
+      RET_ON_ERR(load_wordlists(dict, wordlist_files));
+    }
+
+    ConfigConvKey user_enc = config_->retrieve_value("encoding");
+    if (user_enc.val == "none")
+      config_->replace("encoding", lang_->charmap());
+
+    return finish_setup();
+  }
+
+  PosibErr<void> SpellerImpl::setup_other_dicts()
+  {
     bool use_other_dicts = config_->retrieve_bool("use-other-dicts");
 
     if (use_other_dicts && !personal_)
@@ -636,47 +1051,66 @@ namespace aspeller {
       RET_ON_ERR(add_dict(new SpellerDict(temp, *config_, personal_repl_id)));
     }
 
-    StringList wordlist_files;
-    config_->retrieve_list("wordlists", &wordlist_files);
-    if (!wordlist_files.empty()) {
-      Dictionary * dict = session_;
-      if (!dict) {
-        dict = new_default_writable_dict(*config_);
-        dict->set_check_lang(lang_name(), *config_);
-        RET_ON_ERR(add_dict(new SpellerDict(dict, *config_)));
-      }
-      const char * fn;
-      StringListEnumeration els = wordlist_files.elements_obj();
-      while ( (fn = els.next()) != 0) {
-        FStream f;
-        RET_ON_ERR(f.open(fn, "r"));
-        IstreamEnumeration els(f);
-        WordListIterator wl_itr(&els, lang_, 0);
-        wl_itr.init_plain(*config_);
-        for (;;) {
-          PosibErr<bool> pe = wl_itr.adv();
-          if (pe.has_err())
-            return pe.with_file(fn);
-          if (!pe.data) break;
-          PosibErr<void> pev = dict->add(wl_itr->word);
-          if (pev.has_err())
-            return pev.with_file(fn);
-        }
+    return no_err;
+  }
+
+  PosibErr<void> SpellerImpl::load_wordlists(Dictionary * dict,
+                                             const StringList & files)
+  {
+    const char * fn;
+    StringListEnumeration els = files.elements_obj();
+    while ( (fn = els.next()) != 0) {
+      FStream f;
+      RET_ON_ERR(f.open(fn, "r"));
+      IstreamEnumeration els(f);
+      WordListIterator wl_itr(&els, lang_, 0);
+      wl_itr.init_plain(*config_);
+      for (;;) {
+        PosibErr<bool> pe = wl_itr.adv();
+        if (pe.has_err())
+          return pe.with_file(fn);
+        if (!pe.data) break;
+        PosibErr<void> pev = dict->add(wl_itr->word);
+        if (pev.has_err())
+          return pev.with_file(fn);
       }
     }
+    return no_err;
+  }
+
+  //
+  // Everything that does not depend on how the dictionaries were
+  // obtained, shared by setup and clone.
+  //
+  PosibErr<void> SpellerImpl::finish_setup()
+  {
+    ignore_repl = config_->retrieve_bool("ignore-repl");
+    ignore_count = config_->retrieve_int("ignore");
+
+    s_cmp.lang = lang_;
+    s_cmp.case_insensitive = config_->retrieve_bool("ignore-case");
+
+    s_cmp_begin.lang = lang_; 
+    s_cmp_begin.case_insensitive = s_cmp.case_insensitive;
+    s_cmp_begin.end = false;
+
+    s_cmp_middle.lang = lang_;
+    s_cmp_middle.case_insensitive = s_cmp.case_insensitive;
+    s_cmp_middle.begin = false;
+    s_cmp_middle.end   = false;
+
+    s_cmp_end.lang = lang_;
+    s_cmp_end.case_insensitive = s_cmp.case_insensitive;
+    s_cmp_end.begin = false;
 
     const char * sys_enc = lang_->charmap();
     ConfigConvKey user_enc = config_->retrieve_value("encoding");
-    if (user_enc.val == "none") {
-      config_->replace("encoding", sys_enc);
-      user_enc = sys_enc;
-    }
 
     PosibErr<Convert *> conv;
-    conv = new_convert(*c, user_enc, sys_enc, NormFrom);
+    conv = new_convert(*config_, user_enc, sys_enc, NormFrom);
     if (conv.has_err()) return conv;
     to_internal_.reset(conv);
-    conv = new_convert(*c, sys_enc, user_enc, NormTo);
+    conv = new_convert(*config_, sys_enc, user_enc, NormTo);
     if (conv.has_err()) return conv;
     from_internal_.reset(conv);
 
@@ -692,6 +1126,15 @@ namespace aspeller {
 
     camel_case_ = config_->retrieve_bool("camel-case");
 
+    int cache_size = config_->retrieve_int("check-cache-size");
+    check_cache_size_ = cache_size > 0 ? cache_size : 0;
+
+    cache_size = config_->retrieve_int("sug-cache-size");
+    sug_cache_size_ = cache_size > 0 ? cache_size : 0;
+
+    int deadline = config_->retrieve_int("sug-deadline-us");
+    sug_deadline_us_ = deadline > 0 ? deadline : 0;
+
     config_->add_notifier(new ConfigNotifier(this));
 
     config_->set_attached(true);
@@ -763,12 +1206,62 @@ namespace aspeller {
     return no_err;
   }
 
+  //////////////////////////////////////////////////////////////////////
+  //
+  // SpellerImpl clone
+  //
+
+  PosibErr<Speller *> SpellerImpl::clone(bool share_word_lists) const
+  {
+    StackPtr<SpellerImpl> m(new SpellerImpl);
+    m->config_.reset(config_->clone());
+    m->config_->set_attached(false);
+
+    // dicts_ is in the reverse order they were added in
+    Vector<const SpellerDict *> to_add;
+    for (const SpellerDict * i = dicts_; i; i = i->next)
+      to_add.push_back(i);
+
+    while (!to_add.empty()) {
+      const SpellerDict * i = to_add.back();
+      to_add.pop_back();
+      if (!share_word_lists && (i->special_id == personal_id ||
+                                i->special_id == session_id ||
+                                i->special_id == personal_repl_id))
+        continue;
+      i->dict->copy();
+      SpellerDict * d = new SpellerDict(i->dict);
+      d->use_to_check    = i->use_to_check;
+      d->use_to_suggest  = i->use_to_suggest;
+      d->save_on_saveall = i->save_on_saveall;
+      d->special_id      = i->special_id;
+      RET_ON_ERR(m->add_dict(d));
+    }
+
+    if (!share_word_lists) {
+      RET_ON_ERR(m->setup_other_dicts());
+      StringList wordlist_files;
+      m->config_->retrieve_list("wordlists", &wordlist_files);
+      // without a session the words are in a dictionary of their own
+      // which was shared above
+      if (!wordlist_files.empty() && m->session_)
+        RET_ON_ERR(m->load_wordlists(m->session_, wordlist_files));
+    }
+
+    RET_ON_ERR(m->finish_setup());
+    return m.release();
+  }
+
   //////////////////////////////////////////////////////////////////////
   //
   // SpellerImpl destrution members
   //
 
   SpellerImpl::~SpellerImpl() {
+    // the suggestion cache is keyed on the main dictionary so let go
+    // of it first
+    suggest_.reset();
+    intr_suggest_.reset();
     while (dicts_) {
       SpellerDict * next = dicts_->next;
       delete dicts_;
@@ -12,17 +12,22 @@
 #include "enumeration.hpp"
 #include "speller.hpp"
 #include "check_list.hpp"
+#include "check_cache.hpp"
+#include "vararray.hpp"
 
 using namespace acommon;
 
 namespace acommon {
   class StringMap;
+  class StringList;
   class Config;
   class WordList;
 }
 // The speller class is responsible for keeping track of the
 // dictionaries coming up with suggestions and the like. Its methods
-// are NOT meant to be used my multiple threads and/or documents.
+// are NOT meant to be used my multiple threads and/or documents,
+// with the exception of the const check and suggest methods which
+// take a SpellerImpl::Context (see below).
 
 namespace aspeller {
 
@@ -54,6 +59,8 @@ namespace aspeller {
 
     PosibErr<void> setup(Config *);
 
+    PosibErr<Speller *> clone(bool share_word_lists) const;
+
     void setup_tokenizer(Tokenizer *);
 
     //
@@ -102,53 +109,115 @@ namespace aspeller {
     PosibErr<bool> check(char * word, char * word_end, /* it WILL modify word */
                          bool try_uppercase,
 			 unsigned run_together_limit,
-			 CheckInfo *, CheckInfo *, GuessInfo *, CompoundInfo * = NULL);
+			 CheckInfo *, CheckInfo *, GuessInfo *, CompoundInfo * = NULL) const;
 
     PosibErr<bool> check(MutableString word) {
-      guess_info.reset();
-      return check(word.begin(), word.end(), false,
-		   unconditional_run_together_ ? run_together_limit_ : 0,
-		   check_inf, check_inf + 8, &guess_info);
+      return check(word, cx_);
     }
     PosibErr<bool> check(ParmString word)
     {
       size_t sz = word.size();
-      std::vector<char> w(sz+1);
-      memcpy(&*w.begin(), word.str(), sz+1);
-      return check(MutableString(&w.front(), sz));
+      VARARRAY(char, w, sz + 1);
+      memcpy(w, word.str(), sz + 1);
+      return check(MutableString(w, sz));
     }
     PosibErr<bool> check(const char * word) {return check(ParmString(word));}
     PosibErr<bool> check(const char * word, size_t sz)
     {
-      std::vector<char> w(sz+1);
-      memcpy(&*w.begin(), word, sz);
+      VARARRAY(char, w, sz + 1);
+      memcpy(w, word, sz);
       w[sz] = '\0';
-      return check(MutableString(&w.front(), sz));
+      return check(MutableString(w, sz));
     }
 
+    PosibErr<int> check_batch(const char * * words, const int * sizes,
+                              int n, int * results);
+
     CheckInfo * check_runtogether(char * word, char * word_end, /* it WILL modify word */
                                   bool try_uppercase,
                                   unsigned run_together_limit,
                                   CheckInfo *, CheckInfo *,
-                                  GuessInfo *);
+                                  GuessInfo *) const;
     
     bool check_single(char * word, /* it WILL modify word */
                       bool try_uppercase,
-                      CheckInfo & ci, GuessInfo * gi);
+                      CheckInfo & ci, GuessInfo * gi) const;
 
-    bool check_affix(ParmString word, CheckInfo & ci, GuessInfo * gi);
+    bool check_affix(ParmString word, CheckInfo & ci, GuessInfo * gi) const;
 
-    bool check_simple(ParmString, WordEntry &);
+    bool check_simple(ParmString, WordEntry &) const;
+
+    void check_cache_stats(unsigned long * hits, unsigned long * misses) const {
+      *hits = cx_.cache_hits();
+      *misses = cx_.cache_misses();
+    }
 
     const CheckInfo * check_info() {
-      if (check_inf[0].word.str)
-        return check_inf;
-      else if (guess_info.head)
-        return guess_info.head;
-      else
-        return 0;
+      return cx_.check_info();
     }
-    
+
+    //
+    // Reentrant spelling methods
+    //
+    // The scratch state used by check and suggest lives in a Context
+    // rather than in the speller.  The methods taking a Context do not
+    // modify the speller, so as long as the dictionaries and config
+    // are left alone a single speller can be shared among several
+    // threads, each with its own Context.
+    //
+
+    class Context {
+    public:
+      Context() : suggest(0) {clear_check_info(check_inf[0]);}
+      ~Context();
+      // information about the last word checked with this context
+      const CheckInfo * check_info() const {
+        if (check_inf[0].word.str)
+          return check_inf;
+        else if (guess_info.head)
+          return guess_info.head;
+        else
+          return 0;
+      }
+    private:
+      friend class SpellerImpl;
+      Context(const Context &);
+      void operator= (const Context &);
+      CheckInfo check_inf[8];
+      GuessInfo guess_info;
+      Suggest * suggest; // created on first use
+      CheckCache cache;
+    public:
+      unsigned long cache_hits() const {return cache.hits;}
+      unsigned long cache_misses() const {return cache.misses;}
+    };
+
+    // checks the word using the check cache of cx if enabled, the
+    // check info is stored in cx but the guess info in gi if not null
+    PosibErr<bool> check_cached(char * word, char * word_end, /* it WILL modify word */
+                                Context & cx, GuessInfo * gi) const;
+
+    PosibErr<bool> check(MutableString word, Context & cx) const {
+      cx.guess_info.reset();
+      return check_cached(word.begin(), word.end(), cx, &cx.guess_info);
+    }
+    PosibErr<bool> check(ParmString word, Context & cx) const
+    {
+      size_t sz = word.size();
+      VARARRAY(char, w, sz + 1);
+      memcpy(w, word.str(), sz + 1);
+      return check(MutableString(w, sz), cx);
+    }
+
+    // a simple yes/no check that needs no context as it does not
+    // record any check info
+    bool check_word(ParmString word) const;
+
+    PosibErr<const WordList *> suggest(MutableString word, Context & cx) const;
+    // the suggestion list is only valid until the next call to
+    // suggest with the same context.  The suggestion mode is the one
+    // in effect when the context was first used to suggest.
+
     //
     // High level Word List management methods
     //
@@ -164,12 +233,27 @@ namespace aspeller {
     // the suggestion list and the elements in it are only 
     // valid until the next call to suggest.
 
+    PosibErr<const WordList *> suggest_within(MutableString word, int usecs);
+    bool suggest_timed_out() const;
+
+    PosibErr<const WordList *> suggest_begin(MutableString word);
+    PosibErr<const WordList *> suggest_refine();
+    bool suggest_done() const;
+
+    PosibErr<int> suggest_batch(const char * * words, const int * sizes,
+                                int n);
+    PosibErr<const WordList *> batch_suggestions(int i);
+
     PosibErr<void> store_replacement(MutableString mis, 
 				     MutableString cor);
 
     PosibErr<void> store_replacement(const String & mis, const String & cor,
 				     bool memory);
 
+    PosibErr<void> warm();
+
+    StringPairEnumeration * dict_memory_usage() const;
+
     //
     // Private Stuff (from here to the end of the class)
     //
@@ -189,10 +273,28 @@ namespace aspeller {
     bool                    ignore_repl;
     String                  prev_mis_repl_;
     String                  prev_cor_repl_;
+    String                  batch_buf_;
+    Vector<unsigned>        batch_offsets_;
 
     void operator= (const SpellerImpl &other);
     SpellerImpl(const SpellerImpl &other);
 
+    PosibErr<void> setup_other_dicts();
+    PosibErr<void> load_wordlists(Dictionary *, const StringList &);
+    PosibErr<void> finish_setup();
+
+    PosibErr<void> convert_batch(const char * fun, const char * * words,
+                                 const int * sizes, int n);
+
+    class RunTogetherMemo;
+    CheckInfo * check_runtogether(char * word, char * word_end, /* it WILL modify word */
+                                  bool try_uppercase,
+                                  unsigned run_together_limit,
+                                  CheckInfo *, CheckInfo *,
+                                  GuessInfo *, RunTogetherMemo &) const;
+
+    void prefetch(const char * word) const;
+
     SpellerDict * dicts_;
     
     Dictionary       * personal_;
@@ -213,8 +315,7 @@ namespace aspeller {
     double distance (const char *, const char *, 
 		     const char *, const char *) const;
 
-    CheckInfo check_inf[8];
-    GuessInfo guess_info;
+    Context cx_;
 
     SensitiveCompare s_cmp;
     SensitiveCompare s_cmp_begin;  // These (s_cmp_begin,middle,end)
@@ -224,6 +325,26 @@ namespace aspeller {
     typedef Vector<const Dict *> WS;
     WS check_ws, affix_ws, suggest_ws, suggest_affix_ws;
 
+    // size of the check cache of each context, 0 to disable it
+    unsigned int            check_cache_size_;
+    // changed whenever a cached check result may no longer be valid
+    unsigned int            check_generation_;
+    void invalidate_check_cache() {++check_generation_;}
+
+    // number of suggestion lists to cache, 0 to disable it
+    unsigned int            sug_cache_size_;
+    // the time suggest may take in microseconds, 0 for no limit
+    long                    sug_deadline_us_;
+    // changed, to a value no speller has had before, whenever the
+    // options change; 0 while they are still the ones the speller was
+    // set up with
+    unsigned long           sug_generation_;
+    void invalidate_sug_cache();
+    // appends to key what, besides the word, the options and the main
+    // dictionary, the suggestions depend on
+    void sug_cache_key(String & key) const;
+    const Dictionary * main_dict() const {return main_;}
+
     bool                    unconditional_run_together_;
     unsigned int            run_together_limit_;
     unsigned int            run_together_min_;
@@ -249,11 +370,11 @@ namespace aspeller {
   };
 
   struct LookupInfo {
-    SpellerImpl * sp;
+    const SpellerImpl * sp;
     enum Mode {Word, Guess, Clean, Soundslike, AlwaysTrue} mode;
     SpellerImpl::WS::const_iterator begin;
     SpellerImpl::WS::const_iterator end;
-    inline LookupInfo(SpellerImpl * s, Mode m);
+    inline LookupInfo(const SpellerImpl * s, Mode m);
     // returns 0 if nothing found
     // 1 if a match is found
     // -1 if a word is found but affix doesn't match and "gi"
@@ -261,7 +382,7 @@ namespace aspeller {
                 WordEntry & o, GuessInfo * gi) const;
   };
 
-  inline LookupInfo::LookupInfo(SpellerImpl * s, Mode m) 
+  inline LookupInfo::LookupInfo(const SpellerImpl * s, Mode m) 
     : sp(s), mode(m) 
   {
     switch (m) { 
@@ -40,6 +40,15 @@
 //   store the number of letters that are the same as the previous 
 //     soundslike so that it can possible be skipped
 
+#include <time.h>
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+#include <algorithm>
+
 #include "getdata.hpp"
 
 #include "fstream.hpp"
@@ -47,6 +56,7 @@
 #include "speller_impl.hpp"
 #include "asuggest.hpp"
 #include "basic_list.hpp"
+#include "cache-t.hpp"
 #include "clone_ptr-t.hpp"
 #include "config.hpp"
 #include "data.hpp"
@@ -62,6 +72,7 @@
 #include "suggest.hpp"
 #include "vararray.hpp"
 #include "string_list.hpp"
+#include "lock.hpp"
 
 #include "gettext.h"
 
@@ -99,6 +110,10 @@ namespace {
 
   static const char * NO_SOUNDSLIKE = "";
 
+  // a word with at least this frequency is considered common, see
+  // Working::have_enough_common
+  static const int COMMON_FREQUENCY = 128;
+
   class Working;
 
   enum SpecialEdit {None, Split, CamelSplit, CamelJoin, CamelOffByOne};
@@ -155,11 +170,12 @@ namespace {
     int           adj_score;
     int           word_score;
     int           soundslike_score;
+    int           frequency; // from the dictionary, 0 if not known
     bool          count;
     SpecialEdit   special_edit;
     bool          repl_table;
     WordEntry * repl_list;
-    ScoreWordSound(Working * s) : src(s), adj_score(LARGE_NUM), repl_list(0) {}
+    ScoreWordSound(Working * s) : src(s), adj_score(LARGE_NUM), frequency(0), repl_list(0) {}
     ~ScoreWordSound() {delete repl_list;}
   };
 
@@ -168,6 +184,10 @@ namespace {
   {
     int temp = lhs.score - rhs.score;
     if (temp) return temp;
+    // of two words with the same score the more frequent one is
+    // more likely to be the right one
+    temp = rhs.frequency - lhs.frequency;
+    if (temp) return temp;
     return strcmp(lhs.word,rhs.word);
   }
 
@@ -176,6 +196,8 @@ namespace {
   {
     int temp = lhs.adj_score - rhs.adj_score;
     if (temp) return temp < 0;
+    temp = rhs.frequency - lhs.frequency;
+    if (temp) return temp < 0;
     return strcmp(lhs.word,rhs.word) < 0;
   }
 
@@ -195,6 +217,40 @@ namespace {
   }
 
   typedef BasicList<ScoreWordSound> NearMisses;
+
+  // The time by which suggesting must be done, see sug-deadline-us.
+  // passed() only reads the clock so the scan threads can share one.
+  class Deadline {
+    double end_; // in microseconds, 0 if there is no deadline
+    // wall clock time, not clock() which is the CPU time of all the
+    // threads of the process
+    static double now() {
+#if defined(HAVE_CLOCK_GETTIME)
+      struct timespec t;
+      clock_gettime(CLOCK_MONOTONIC, &t);
+      return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+#elif defined(WIN32)
+      return GetTickCount64() * 1e3;
+#else
+      struct timeval t;
+      gettimeofday(&t, 0);
+      return t.tv_sec * 1e6 + t.tv_usec;
+#endif
+    }
+  public:
+    Deadline() : end_(0) {}
+    // sets the deadline usecs microseconds from now, or removes it
+    // if usecs is not more than 0
+    void set(long usecs) {end_ = usecs > 0 ? now() + usecs : 0;}
+    bool passed() const {return end_ != 0 && now() >= end_;}
+  };
+
+  // The loops only read the clock when their count has none of the
+  // bits of the mask set: every 256 soundslikes when scanning but
+  // every 16 scan hits or near misses when adding or scoring them as
+  // that takes far longer.
+  static const unsigned scan_check_mask = 0xFF;
+  static const unsigned score_check_mask = 0x0F;
  
   class Sugs;
   
@@ -204,7 +260,10 @@ namespace {
     const Language *     lang;
     OriginalWord         original;
     const SuggestParms * parms;
-    SpellerImpl *        sp;
+    const SpellerImpl *  sp;
+
+    const Deadline *     deadline; // null if there is none
+    bool out_of_time() const {return deadline && deadline->passed();}
 
     String prefix;
     String suffix;
@@ -216,6 +275,8 @@ namespace {
 
     EditDist (* edit_dist_fun)(const char *, const char *,
                                const EditDistanceWeights &);
+    int edit_dist_limit; // of edit_dist_fun
+    Vector<const char *> scan_sls; // the soundslikes to scan for
 
     unsigned int max_word_length;
 
@@ -240,6 +301,30 @@ namespace {
     void abort_temp() {
       buffer.abort_temp();
       temp_end = 0;}
+    // Copies of the soundslike strings from dictionaries with a
+    // transient soundslike, by the position of the entry.  The same
+    // entry always gets the same copy so that, as with other
+    // dictionaries, the pointers can be compared.
+    hash_map<unsigned long, const char *> sl_copies;
+    static unsigned long sl_key(const WordEntry * sw, const char * sl) {
+      return (unsigned long)(sw->intr[0] ? sw->intr[0] : sl);}
+    // like commit_temp, but if sl came from the soundslike
+    // enumeration of d and may not stay valid it is copied
+    const char * commit_sl(const char * sl, const WordEntry * sw, 
+                           const Dictionary * d) {
+      if (temp_end) {commit_temp(sl); return sl;}
+      if (!d->transient_soundslike) return sl;
+      const char * & copy = sl_copies[sl_key(sw, sl)];
+      if (!copy) copy = buffer.dup(sl);
+      return copy;}
+    // returns the pointer commit_sl returned for sl, or null if it
+    // was never committed
+    const char * committed_sl(const char * sl, const WordEntry * sw, 
+                              const Dictionary * d) {
+      if (!d->transient_soundslike) return sl;
+      hash_map<unsigned long, const char *>::iterator i 
+        = sl_copies.find(sl_key(sw, sl));
+      return i == sl_copies.end() ? 0 : i->second;}
     const char * to_soundslike_temp(const char * w, unsigned s, unsigned * len = 0) {
       char * sl = (char *)buffer.alloc_temp(s + 1);
       temp_end = lang->LangImpl::to_soundslike(sl, w, s);
@@ -260,13 +345,15 @@ namespace {
       const char *  soundslike;
       int           word_score;
       int           soundslike_score;
+      int           frequency;
       bool          count;
       SpecialEdit   special_edit;
       bool          repl_table;
       WordEntry *   repl_list;
       ScoreInfo()
         : soundslike(), word_score(LARGE_NUM), soundslike_score(LARGE_NUM),
-          count(true), special_edit(None), repl_table(false), repl_list() {}
+          frequency(0), count(true), special_edit(None), repl_table(false), 
+          repl_list() {}
     };
 
     char * fix_case(char * str) {
@@ -323,7 +410,7 @@ namespace {
       return (parms->word_weight*word_score 
 	      + parms->soundslike_weight*soundslike_score)/100;
     }
-    int adj_wighted_average(int soundslike_score, int word_score, int one_edit_max) {
+    int adj_wighted_average(int soundslike_score, int word_score, int one_edit_max) const {
       int soundslike_weight = parms->soundslike_weight;
       int word_weight = parms->word_weight;
       if (word_score <= one_edit_max) {
@@ -342,6 +429,25 @@ namespace {
       return (word_weight*word_score
               + soundslike_weight*soundslike_score)/100;
     }
+    // returns true if the scored near misses within the threshold
+    // already include parms->freq_stop common words, in which case
+    // there is little point in looking any further
+    bool have_enough_common() {
+      if (parms->freq_stop <= 0) return false;
+      int num = 0;
+      const char * prev_word = "";
+      for (NearMisses::iterator i = scored_near_misses.begin();
+           i != scored_near_misses.end() && i->score <= threshold;
+           ++i)
+      {
+        if (i->frequency < COMMON_FREQUENCY || strcmp(prev_word, i->word) == 0)
+          continue;
+        prev_word = i->word;
+        if (++num >= parms->freq_stop) return true;
+      }
+      return false;
+    }
+
     int skip_first_couple(NearMisses::iterator & i) {
       int k = 0;
       InsensitiveCompare cmp(lang);
@@ -368,17 +474,157 @@ namespace {
     void try_split();
     void try_camel_edits();
     void try_one_edit_word();
-    void try_scan();
-    void try_scan_root();
+
+    // The steps after try_one_edit_word, in the order they are done.
+    // Each of the scan steps looks through all the soundslikes in the
+    // dictionaries, so when suggesting for several words at once the
+    // words at the same step share the scan.
+    enum Step {Scan0, Scan1, Scan2, NGram, Done};
+    Step start();
+    Step next_step(int after) const;
+    Step finish_step(Step);
+    void prepare_scan(Step);
+    Sugs * finish();
+
+    // A Working taking part in a scan and the soundslikes it looks for
+    struct ScanTarget {
+      Working *            working;
+      const char * const * sls;
+      const char * const * sls_end;
+    };
+
+    // A soundslike close enough to one being looked for, found while
+    // scanning a part of a dictionary
+    struct ScanHit {
+      unsigned     target;
+      WordEntry    sw;
+      const char * sl;
+      const char * word; // the expanded word in the affix case, else null
+      unsigned     word_size;
+      int          score;
+      bool         sl_is_temp; // sl was computed rather than taken from sw
+    };
+
+    struct ScanPart {
+      const Dictionary *      dict;
+      SoundslikeEnumeration * els;
+      const ScanTarget *      targets;
+      unsigned                num_targets;
+      bool                    root;       // only the roots have a soundslike
+      int                     stopped_at; // the hint for next()
+      bool                    scanned;    // if els returned anything
+      Vector<ScanHit>         hits;
+      ObjStack                buffer;     // for the strings of the hits
+      ObjStack                temp_buffer;
+      char *                  sl_end;     // of a soundslike in the temp
+                                          // memory of buffer, if any
+      // The targets the next soundslike must be scored against.  A
+      // target which did not match a soundslike, with the edit
+      // distance stopping at its i-th character, will not match any
+      // other starting with the same i + 1 characters, so it is kept
+      // in skipped[i + 1] until a soundslike which does not comes
+      // along.  As the soundslikes are grouped by their first
+      // characters that happens once the first i + 1 characters of
+      // two soundslikes in a row differ.
+      static const unsigned max_skip = 64;
+      Vector<unsigned>        active;
+      Vector<unsigned>        skipped[max_skip];
+      unsigned                max_skipped; // the highest non-empty skipped
+      String                  prev_sl;
+      ScanPart() : els(0), sl_end(0), max_skipped(0) {}
+      ~ScanPart() {delete els;}
+      void start_targets() {
+        release(0);
+        active.clear();
+        for (unsigned t = 0; t != num_targets; ++t) active.push_back(t);
+        prev_sl.clear();}
+      void release(unsigned shared) {
+        for (; max_skipped > shared; --max_skipped) {
+          active.insert(active.end(), skipped[max_skipped].begin(),
+                        skipped[max_skipped].end());
+          skipped[max_skipped].clear();
+        }
+        while (max_skipped > 0 && skipped[max_skipped].empty()) --max_skipped;}
+      // moves on to sl, making active the targets which must look at it
+      void next_sl(const char * sl) {
+        // the null counts so that a soundslike shares all of itself
+        // with an identical one
+        const char * p = prev_sl.str();
+        unsigned shared = 0;
+        while (shared <= prev_sl.size() && p[shared] == sl[shared])
+          ++shared;
+        release(shared);
+        prev_sl = sl;}
+      // returns false if t can not be skipped and must stay active
+      bool skip(unsigned t, unsigned stopped_at) {
+        unsigned n = stopped_at + 1;
+        if (n >= max_skip) return false;
+        skipped[n].push_back(t);
+        if (n > max_skipped) max_skipped = n;
+        return true;}
+      // the hint for next() which allows the skipped targets to skip
+      unsigned skipped_hint() const {
+        return max_skipped ? max_skipped - 1 : 0;}
+      void clear() {
+        delete els; els = 0; hits.clear();
+        buffer.reset(); temp_buffer.reset(); sl_end = 0;}
+      const char * to_soundslike_temp(const Language * lang, 
+                                      const char * w, unsigned s,
+                                      unsigned * len = 0) {
+        char * sl = (char *)buffer.alloc_temp(s + 1);
+        sl_end = lang->LangImpl::to_soundslike(sl, w, s);
+        if (len) *len = sl_end - sl;
+        return sl;}
+      const char * to_soundslike_temp(const Language * lang, 
+                                      const WordEntry & sw) {
+        char * sl = (char *)buffer.alloc_temp(sw.word_size + 1);
+        sl_end = lang->LangImpl::to_soundslike(sl, sw.word, sw.word_size, 
+                                               sw.word_info);
+        if (sl_end == 0) return sw.word;
+        else return sl;}
+      void abort_temp() {
+        buffer.abort_temp(); sl_end = 0;}
+      const char * commit_sl(const char * sl, bool * is_temp) {
+        *is_temp = sl_end != 0;
+        if (sl_end) {
+          buffer.resize_temp(sl_end - sl + 1);
+          buffer.commit_temp();
+          sl_end = 0;
+        }
+        return sl;}
+      void add_sound(unsigned t, const WordEntry & sw, const char * sl,
+                     int score);
+      void add_word(unsigned t, const WordEntry & sw, 
+                    const SimpleString & word, const char * sl, int score);
+      // adds a hit for target t for the same word as the last one
+      void add_again(unsigned t, int score) {
+        ScanHit h = hits.back();
+        h.target = t;
+        h.score = score;
+        hits.push_back(h);}
+    };
+    struct ScanQueue;
+
+    void scan(const ScanTarget * targets, unsigned num_targets, bool root);
+    void scan_part(ScanPart &) const;
+    void scan_root_part(ScanPart &) const;
+    static void add_scan_hits(SpellerImpl::WS::const_iterator i, ScanPart &);
+    static bool scan_hit_lt(const ScanHit &, const ScanHit &);
+    void add_scan_hit(SpellerImpl::WS::const_iterator i, ScanHit &);
+    static void * scan_thread(void *);
     void try_repl();
     void try_ngram();
 
     void score_list();
+    ParmString normalized_original(CharVector & buf) const;
+    void typo_scores(const ScoreWordSound & i, ParmString orig, 
+                     CharVector & word, int & word_score, 
+                     int & soundslike_score, int & adj_score) const;
     void fine_tune_score(int thres);
   public:
-    Working(SpellerImpl * m, const Language *l,
+    Working(const SpellerImpl * m, const Language *l,
 	    const String & w, const SuggestParms * p)
-      : lang(l), original(), parms(p), sp(m), have_presuf(false) 
+      : lang(l), original(), parms(p), sp(m), deadline(0), have_presuf(false) 
       , threshold(1), max_word_length(0)
     {
       memset(static_cast<void *>(check_info), 0, sizeof(check_info));
@@ -389,6 +635,9 @@ namespace {
       original.case_pattern = l->case_pattern(w);
       camel_case = parms->camel_case;
     }
+    // once d has passed the remaining steps are skipped and the
+    // suggestions found so far are returned
+    void with_deadline(const Deadline * d) {deadline = d;}
     void with_presuf(ParmStr pre, ParmStr suf) {
       prefix = pre;
       suffix = suf;
@@ -398,20 +647,24 @@ namespace {
     // `this` is expected to be allocated with new and its ownership
     // will be transferred to the returning Sugs object
     Sugs * suggestions(); 
+    // like suggestions() for each of ws, storing the Sugs objects in
+    // res, but with the scans of the dictionaries shared
+    static void suggestions(Working * const * ws, unsigned n, Sugs * * res);
+    class Steps;
   };
 
   struct Suggestion {
     const char * word;
-    const ScoreWordSound * inf;
+    int score; // the adj_score of the near miss
     double distance() const {
-      return inf->adj_score/100.0;
+      return score/100.0;
     }
     double normalized_score() const {
-      return 100.0/(inf->adj_score + 100);
+      return 100.0/(score + 100);
     }
-    Suggestion() : word(), inf() {}
-    Suggestion(const char * word, const ScoreWordSound * inf)
-      : word(word), inf(inf) {}
+    Suggestion() : word(), score() {}
+    Suggestion(const char * word, int score)
+      : word(word), score(score) {}
   };
 
   struct SavedBufs : public Vector<ObjStack::Memory *> {
@@ -500,17 +753,117 @@ namespace {
   };
 
   Sugs * Working::suggestions() {
+    Working * w = this;
+    Sugs * sug;
+    suggestions(&w, 1, &sug);
+    return sug;
+  }
 
-    Sugs * sug = new Sugs(this);
+  // Does the steps of Working::suggestions one at a time, so that the
+  // suggestions found so far can be looked at in between.  Owns the
+  // Workings until finish hands them over to the Sugs objects.
+  class Working::Steps {
+    Vector<Working *> ws_;
+    Vector<Step> steps_;
+    Steps(const Steps &);
+    void operator=(const Steps &);
+  public:
+    // does the work before the first scan for each of ws
+    Steps(Working * const * ws, unsigned n);
+    ~Steps();
+    unsigned size() const {return ws_.size();}
+    bool done() const;
+    // does the earliest step any of the Workings still needs, for all
+    // of those which need it
+    void next();
+    // fills res with what transfer would if the Workings were
+    // finished now, but without changing them
+    void preview(SuggestionsImpl & res, int limit) const;
+    // stores the Sugs objects in res, once done
+    void finish(Sugs * * res);
+  };
+
+  void Working::suggestions(Working * const * ws, unsigned n, Sugs * * res) 
+  {
+    Steps steps(ws, n);
+    while (!steps.done())
+      steps.next();
+    steps.finish(res);
+  }
+
+  Working::Steps::Steps(Working * const * ws, unsigned n)
+    : steps_(n)
+  {
+    ws_.append(ws, n);
+    for (unsigned i = 0; i != n; ++i)
+      steps_[i] = ws[i]->start();
+  }
+
+  Working::Steps::~Steps()
+  {
+    for (unsigned i = 0; i != ws_.size(); ++i)
+      delete ws_[i];
+  }
+
+  bool Working::Steps::done() const
+  {
+    for (unsigned i = 0; i != steps_.size(); ++i)
+      if (steps_[i] != Done) return false;
+    return true;
+  }
+
+  void Working::Steps::next()
+  {
+    // The words only ever move on to a later step so all the ones
+    // which need a step can do it at the same time.
+    Step step = Done;
+    for (unsigned i = 0; i != steps_.size(); ++i)
+      if (steps_[i] < step) step = steps_[i];
+    if (step == Done) return;
+
+    Vector<ScanTarget> targets;
+    for (unsigned i = 0; i != ws_.size(); ++i) {
+      if (steps_[i] != step) continue;
+#ifdef DEBUG_SUGGEST
+      static const char * const step_names[] 
+        = {"SCAN 0", "SCAN 1", "SCAN 2", "NGRAM"};
+      COUT.printf("TRYING %s\n", step_names[step]);
+#endif
+      if (step == NGram) {
+        ws_[i]->try_ngram();
+      } else {
+        ws_[i]->prepare_scan(step);
+        ScanTarget t = {ws_[i], ws_[i]->scan_sls.pbegin(), ws_[i]->scan_sls.pend()};
+        targets.push_back(t);
+      }
+    }
+    if (!targets.empty())
+      targets[0].working->scan(targets.pbegin(), targets.size(),
+                               targets[0].working->sp->soundslike_root_only);
+    for (unsigned i = 0; i != ws_.size(); ++i) {
+      if (steps_[i] == step) steps_[i] = ws_[i]->finish_step(step);
+    }
+  }
+
+  void Working::Steps::finish(Sugs * * res)
+  {
+    for (unsigned i = 0; i != ws_.size(); ++i)
+      res[i] = ws_[i]->finish();
+    ws_.clear();
+  }
+
+  // Does the work before the first scan and returns the first step
+  // needed.
+  Working::Step Working::start() {
 
     if (original.word.size() * parms->edit_distance_weights.max >= 0x8000)
-      return sug; // to prevent overflow in the editdist functions
+      return Done; // to prevent overflow in the editdist functions
 
     try_split();
 
     try_camel_edits();
 
-    if (parms->use_repl_table) {
+    if (parms->use_repl_table && !out_of_time()) {
 
 #ifdef DEBUG_SUGGEST
       COUT.printl("TRYING REPLACEMENT TABLE");
@@ -519,7 +872,7 @@ namespace {
       try_repl();
     }
 
-    if (parms->try_one_edit_word) {
+    if (parms->try_one_edit_word && !out_of_time()) {
 
 #ifdef DEBUG_SUGGEST
       COUT.printl("TRYING ONE EDIT WORD");
@@ -528,81 +881,89 @@ namespace {
       try_one_edit_word();
       score_list();
       if (parms->check_after_one_edit_word) {
-        if (try_harder <= 0) goto done;
+        if (try_harder <= 0) return Done;
       }
+      if (have_enough_common()) return Done;
       // need to fine tune the score to account for special weights
       // applied to typos, otherwise some typos that produce very
       // different soundslike may be missed
       fine_tune_score(LARGE_NUM);
     }
 
-    if (parms->try_scan_0) {
-      
-#ifdef DEBUG_SUGGEST
-      COUT.printl("TRYING SCAN 0");
-#endif
-      edit_dist_fun = limit0_edit_distance;
-      
-      if (sp->soundslike_root_only)
-        try_scan_root();
-      else
-        try_scan();
-
+    if (out_of_time()) {
+      // what the steps so far found still needs to be scored
       score_list();
-      
+      return Done;
     }
 
-    if (parms->try_scan_1) {
-      
-#ifdef DEBUG_SUGGEST
-      COUT.printl("TRYING SCAN 1");
-#endif
-      edit_dist_fun = limit1_edit_distance;
+    return next_step(-1);
+  }
 
-      if (sp->soundslike_root_only)
-        try_scan_root();
-      else
-        try_scan();
+  // returns the first step enabled by parms after "after", or Done
+  // if there is no time left for another
+  Working::Step Working::next_step(int after) const {
+    if (out_of_time()) return Done;
+    if (after < Scan0 && parms->try_scan_0) return Scan0;
+    if (after < Scan1 && parms->try_scan_1) return Scan1;
+    if (after < Scan2 && parms->try_scan_2) return Scan2;
+    if (after < NGram && parms->try_ngram)  return NGram;
+    return Done;
+  }
 
-      score_list();
-      
-      if (try_harder <= 0) goto done;
+  // Scores what step found and returns the next step needed.
+  Working::Step Working::finish_step(Step step) {
 
-    }
+    score_list();
 
-    if (parms->try_scan_2) {
+    if (step == Scan1 && (try_harder <= 0 || have_enough_common()))
+      return Done;
 
-#ifdef DEBUG_SUGGEST
-      COUT.printl("TRYING SCAN 2");
-#endif
+    if (step == Scan2 && (try_harder < parms->ngram_threshold 
+                          || have_enough_common()))
+      return Done;
 
-      edit_dist_fun = limit2_edit_distance;
+    return next_step(step);
+  }
 
-      if (sp->soundslike_root_only)
-        try_scan_root();
-      else
-        try_scan();
+  void Working::prepare_scan(Step step) {
 
-      score_list();
-      
-      if (try_harder < parms->ngram_threshold) goto done;
+    static EditDist (* const funs[])(const char *, const char *,
+                                     const EditDistanceWeights &)
+      = {limit0_edit_distance, limit1_edit_distance, limit2_edit_distance};
+    edit_dist_fun = funs[step];
+    edit_dist_limit = step;
 
-    }
+    scan_sls.clear();
+    scan_sls.push_back(original.soundslike.str());
 
-    if (parms->try_ngram) {
+    if (!sp->soundslike_root_only) return;
 
 #ifdef DEBUG_SUGGEST
-      COUT.printl("TRYING NGRAM");
+    COUT.printf("will try soundslike: %s\n", scan_sls.back());
 #endif
 
-      try_ngram();
-
-      score_list();
-
+    // also look for the soundslike of any possible roots
+    const char * sl = 0;
+    GuessInfo gi;
+    lang->munch(original.word, &gi);
+    for (const aspeller::CheckInfo * ci = gi.head;
+         ci; 
+         ci = ci->next) 
+    {
+      sl = to_soundslike(ci->word.str, ci->word.len);
+      Vector<const char *>::iterator i = scan_sls.begin();
+      while (i != scan_sls.end() && strcmp(*i, sl) != 0) ++i;
+      if (i == scan_sls.end()) {
+        scan_sls.push_back(to_soundslike(ci->word.str, ci->word.len));
+#ifdef DEBUG_SUGGEST
+        COUT.printf("will try root soundslike: %s\n", scan_sls.back());
+#endif
+      }
     }
+  }
 
-  done:
-
+  Sugs * Working::finish() {
+    Sugs * sug = new Sugs(this);
     fine_tune_score(threshold);
     scored_near_misses.sort(adj_score_lt);
     sug->scored_near_misses.swap(scored_near_misses);
@@ -732,6 +1093,7 @@ namespace {
 
     d.word_score = inf.word_score;
     d.soundslike_score = inf.soundslike_score;
+    d.frequency = inf.frequency;
 
     if (!sp->have_soundslike) {
       if (d.word_score >= LARGE_NUM) d.word_score = d.soundslike_score;
@@ -762,6 +1124,7 @@ namespace {
   {
     assert(w.word_size == strlen(w.word));
     ScoreInfo inf = inf0;
+    inf.frequency = w.frequency;
     if (w.what == WordEntry::Misspelled) {
       inf.repl_list = new WordEntry;
       const ReplacementDict * repl_dict
@@ -796,7 +1159,7 @@ namespace {
       new_word[i+1] = new_word[i];
       new_word[i] = '\0';
       
-      if (sp->check(new_word) && sp->check(new_word + i + 1)) {
+      if (sp->check_word(new_word) && sp->check_word(new_word + i + 1)) {
         for (size_t j = 0; j != parms->split_chars.size(); ++j)
         {
           new_word[i] = parms->split_chars[j];
@@ -957,183 +1320,423 @@ namespace {
         temp_buffer.reset();
         WordAff * exp_list;
         exp_list = lang->affix()->expand(w.word, w.aff, temp_buffer);
+        ScoreInfo exp_inf;
+        exp_inf.frequency = w.frequency;
         for (WordAff * p = exp_list->next; p; p = p->next) {
-          add_nearmiss_a(i, p, ScoreInfo());
+          add_nearmiss_a(i, p, exp_inf);
         }
       }
       
     }
   }
 
-  void Working::try_scan() 
+  //
+  // The soundslike scans are done in two steps: scan_part goes
+  // through the soundslike strings of a part of a dictionary and
+  // records the ones that are close enough, then add_scan_hits adds
+  // the words for them in the order they were found.  Since scan_part
+  // does not modify Working, when sug-scan-threads is more than one
+  // and the dictionary can be split (see Dictionary::soundslike_part)
+  // the parts are scanned by separate threads.  The result is the same
+  // as scanning the dictionary at once.
+  //
+  // A scan can also look for the soundslikes of several Workings (the
+  // targets) at once.  Each string is scored against the targets
+  // which might match it (see ScanPart::active) and the hint passed to
+  // next() is the largest of the ones for each target, so nothing is
+  // skipped which any target would have looked at.  Each target gets
+  // the same hits in the same order as when scanning alone (but see
+  // the start of scan).
+  //
+
+  void Working::ScanPart::add_sound(unsigned t, const WordEntry & sw, 
+                                    const char * sl, int score)
+  {
+    ScanHit h;
+    h.target = t;
+    h.sw = sw;
+    h.sl = commit_sl(sl, &h.sl_is_temp);
+    if (!h.sl_is_temp && dict->transient_soundslike) {
+      h.sl = buffer.dup(sl);
+      if (sw.word == sl) h.sw.word = h.sl;
+    }
+    h.word = 0;
+    h.word_size = 0;
+    h.score = score;
+    hits.push_back(h);
+  }
+
+  void Working::ScanPart::add_word(unsigned t, const WordEntry & sw, 
+                                   const SimpleString & word,
+                                   const char * sl, int score)
+  {
+    ScanHit h;
+    h.target = t;
+    h.sw = sw;
+    h.sl = commit_sl(sl, &h.sl_is_temp);
+    h.word = buffer.dup(ParmString(word.str, word.size));
+    h.word_size = word.size;
+    h.score = score;
+    hits.push_back(h);
+  }
+
+  bool Working::scan_hit_lt(const ScanHit & x, const ScanHit & y) {
+    return x.score < y.score;
+  }
+
+  void Working::add_scan_hits(SpellerImpl::WS::const_iterator i, 
+                              ScanPart & part)
+  {
+    for (unsigned t = 0; t != part.num_targets; ++t)
+      part.targets[t].working->abort_temp();
+    // Adding the words for a hit takes a while, so if already out
+    // of time the hits with the lowest scores are added first.
+    const Working * w = part.targets[0].working;
+    if (w->out_of_time())
+      std::stable_sort(part.hits.begin(), part.hits.end(), scan_hit_lt);
+    unsigned count = 0;
+    for (Vector<ScanHit>::iterator h = part.hits.begin(), e = part.hits.end();
+         h != e; ++h)
+    {
+      if ((++count & score_check_mask) == 0 && w->out_of_time()) 
+        break;
+      part.targets[h->target].working->add_scan_hit(i, *h);
+    }
+  }
+
+  void Working::add_scan_hit(SpellerImpl::WS::const_iterator i, ScanHit & h)
+  {
+    if (h.word) {
+      ScoreInfo inf;
+      inf.soundslike = buffer.dup(h.sl);
+      inf.soundslike_score = h.score;
+      inf.frequency = h.sw.frequency;
+      add_nearmiss(buffer.dup(ParmString(h.word, h.word_size)),
+                   h.word_size, 0, inf);
+    } else {
+      const char * sl = h.sl_is_temp 
+        ? buffer.dup(h.sl) : commit_sl(h.sl, &h.sw, *i);
+      add_sound(i, &h.sw, sl, h.score);
+    }
+  }
+
+#ifdef USE_POSIX_MUTEX
+
+  struct Working::ScanQueue {
+    const Working * working;
+    ScanPart *      parts;
+    unsigned        size;
+    unsigned        next;
+    Mutex           lock;
+  };
+
+  void * Working::scan_thread(void * d)
+  {
+    ScanQueue * q = static_cast<ScanQueue *>(d);
+    for (;;) {
+      unsigned p;
+      {
+        LOCK(&q->lock);
+        if (q->next == q->size) return 0;
+        p = q->next++;
+      }
+      if (q->parts[p].root) q->working->scan_root_part(q->parts[p]);
+      else                  q->working->scan_part(q->parts[p]);
+    }
+  }
+
+#endif
+
+  // Scans the dictionaries for the soundslikes of targets, which must
+  // all be using the same edit_dist_fun as this.
+  void Working::scan(const ScanTarget * targets, unsigned num_targets, 
+                     bool root)
+  {
+    // When the soundslike is invisible next() compares the words
+    // rather than their soundslikes to decide what to skip, so a
+    // target could get hits it would not have got scanning alone.
+    // Scan for each target separately in that case.
+    if (num_targets > 1) {
+      for (SpellerImpl::WS::const_iterator i = sp->suggest_ws.begin();
+           i != sp->suggest_ws.end();
+           ++i) 
+      {
+        if (!(*i)->invisible_soundslike) continue;
+        for (unsigned t = 0; t != num_targets; ++t)
+          targets[t].working->scan(targets + t, 1, root);
+        return;
+      }
+    }
+
+    unsigned num_threads = parms->scan_threads;
+#ifndef USE_POSIX_MUTEX
+    num_threads = 1;
+#endif
+    // more parts than threads so that a thread which finishes early
+    // can take another part
+    unsigned max_parts = num_threads > 1 ? 4 * num_threads : 1;
+    ScanPart * parts = new ScanPart[max_parts];
+    int stopped_at = LARGE_NUM;
+
+    Vector<const char *> all_sls;
+    const char * const * sls = targets[0].sls;
+    const char * const * sls_end = targets[0].sls_end;
+    if (num_targets > 1 && parms->use_scan_index) {
+      for (unsigned t = 0; t != num_targets; ++t)
+        all_sls.insert(all_sls.end(), targets[t].sls, targets[t].sls_end);
+      sls = all_sls.pbegin();
+      sls_end = all_sls.pend();
+    }
+
+    for (SpellerImpl::WS::const_iterator i = sp->suggest_ws.begin();
+         i != sp->suggest_ws.end() && !out_of_time();
+         ++i) 
+    {
+      unsigned num_parts = 1;
+      if (parms->use_scan_index)
+        parts[0].els = (*i)->soundslike_neighbors(sls, sls_end, edit_dist_limit);
+      if (!parts[0].els && max_parts > 1
+          && (parts[0].els = (*i)->soundslike_part(0, max_parts))) {
+        num_parts = max_parts;
+        for (unsigned p = 1; p != num_parts; ++p)
+          parts[p].els = (*i)->soundslike_part(p, num_parts);
+      }
+      if (!parts[0].els)
+        parts[0].els = (*i)->soundslike_elements();
+
+      for (unsigned p = 0; p != num_parts; ++p) {
+        parts[p].dict = *i;
+        parts[p].targets = targets;
+        parts[p].num_targets = num_targets;
+        parts[p].root = root;
+        // only the first part continues where the last dictionary
+        // left off, the others start at a new jump1 group and ignore
+        // the hint
+        parts[p].stopped_at = p == 0 ? stopped_at : LARGE_NUM;
+        parts[p].scanned = false;
+      }
+
+      if (num_parts == 1) {
+        if (root) scan_root_part(parts[0]);
+        else      scan_part(parts[0]);
+      } else {
+#ifdef USE_POSIX_MUTEX
+        ScanQueue q;
+        q.working = this;
+        q.parts = parts;
+        q.size = num_parts;
+        q.next = 0;
+        Vector<pthread_t> threads;
+        for (unsigned t = 1; t < num_threads; ++t) {
+          pthread_t thread;
+          if (pthread_create(&thread, 0, scan_thread, &q) != 0) break;
+          threads.push_back(thread);
+        }
+        scan_thread(&q);
+        for (Vector<pthread_t>::iterator t = threads.begin(); 
+             t != threads.end(); ++t)
+          pthread_join(*t, 0);
+#endif
+      }
+
+      for (unsigned p = 0; p != num_parts; ++p) {
+        if (parts[p].scanned) stopped_at = parts[p].stopped_at;
+        add_scan_hits(i, parts[p]);
+        parts[p].clear();
+      }
+    }
+    delete[] parts;
+  }
+
+  void Working::scan_part(ScanPart & part) const
   {
-    const char * original_soundslike = original.soundslike.str();
+    const ScanTarget * targets = part.targets;
+    unsigned num_targets = part.num_targets;
     
     WordEntry * sw;
-    WordEntry w;
     const char * sl = 0;
     EditDist score;
-    unsigned int stopped_at = LARGE_NUM;
+    unsigned int stopped_at = part.stopped_at;
     WordAff * exp_list;
     WordAff single;
     single.next = 0;
+    unsigned count = 0;
+    part.start_targets();
 
-    for (SpellerImpl::WS::const_iterator i = sp->suggest_ws.begin();
-         i != sp->suggest_ws.end();
-         ++i) 
-    {
-      //CERR.printf(">>%p %s\n", *i, typeid(**i).name());
-      StackPtr<SoundslikeEnumeration> els((*i)->soundslike_elements());
+    while ( (sw = part.els->next(stopped_at)) ) {
+
+      if ((++count & scan_check_mask) == 0 && out_of_time()) break;
 
-      while ( (sw = els->next(stopped_at)) ) {
+      part.scanned = true;
 
-        //CERR.printf("[%s (%d) %d]\n", sw->word, sw->word_size, sw->what);
-        //assert(strlen(sw->word) == sw->word_size);
+      //CERR.printf("[%s (%d) %d]\n", sw->word, sw->word_size, sw->what);
+      //assert(strlen(sw->word) == sw->word_size);
           
-        if (sw->what != WordEntry::Word) {
-          sl = sw->word;
-          abort_temp();
-        } else if (!*sw->aff) {
-          sl = to_soundslike_temp(*sw);
-        } else {
-          goto affix_case;
-        }
+      if (sw->what != WordEntry::Word) {
+        sl = sw->word;
+        part.abort_temp();
+      } else if (!*sw->aff) {
+        sl = part.to_soundslike_temp(lang, *sw);
+      } else {
+        goto affix_case;
+      }
 
-        //CERR.printf("SL = %s\n", sl);
-        
-        score = edit_dist_fun(sl, original_soundslike, parms->edit_distance_weights);
-        stopped_at = score.stopped_at - sl;
-        if (score >= LARGE_NUM) continue;
-        stopped_at = LARGE_NUM;
-        commit_temp(sl);
-        add_sound(i, sw, sl, score);
-        continue;
+      //CERR.printf("SL = %s\n", sl);
+
+      {
+        part.next_sl(sl);
+        bool hit = false;
+        stopped_at = part.skipped_hint();
+        unsigned * keep = part.active.pbegin();
+        for (unsigned * a = part.active.pbegin(), * e = part.active.pend(); 
+             a != e; ++a)
+        {
+          unsigned t = *a;
+          score = edit_dist_fun(sl, *targets[t].sls, parms->edit_distance_weights);
+          unsigned int s = score.stopped_at - sl;
+          if (score < LARGE_NUM) {
+            s = LARGE_NUM;
+            if (!hit) part.add_sound(t, *sw, sl, score);
+            else      part.add_again(t, score);
+            hit = true;
+            *keep++ = t;
+          } else if (!part.skip(t, s)) {
+            *keep++ = t;
+          }
+          if (s > stopped_at) stopped_at = s;
+        }
+        part.active.resize(keep - part.active.pbegin());
+      }
+      continue;
         
-      affix_case:
+    affix_case:
+
+      // the expanded words are scored against all the targets
+      part.start_targets();
         
-        temp_buffer.reset();
+      part.temp_buffer.reset();
         
-        // first expand any prefixes
-        if (sp->fast_scan) { // if fast_scan, then no prefixes
-          single.word.str = sw->word;
-          single.word.size = strlen(sw->word);
-          single.aff = (const unsigned char *)sw->aff;
-          exp_list = &single;
-        } else {
-          exp_list = lang->affix()->expand_prefix(sw->word, sw->aff, temp_buffer);
-        }
+      // first expand any prefixes
+      if (sp->fast_scan) { // if fast_scan, then no prefixes
+        single.word.str = sw->word;
+        single.word.size = strlen(sw->word);
+        single.aff = (const unsigned char *)sw->aff;
+        exp_list = &single;
+      } else {
+        exp_list = lang->affix()->expand_prefix(sw->word, sw->aff, 
+                                                part.temp_buffer);
+      }
         
-        // iterate through each semi-expanded word, any affix flags
-        // are now guaranteed to be suffixes
-        for (WordAff * p = exp_list; p; p = p->next)
-        {
-          // try the root word
-          unsigned sl_len;
-          sl = to_soundslike_temp(p->word.str, p->word.size, &sl_len);
-          score = edit_dist_fun(sl, original_soundslike, parms->edit_distance_weights);
-          stopped_at = score.stopped_at - sl;
-          stopped_at += p->word.size - sl_len;
-          
+      // iterate through each semi-expanded word, any affix flags
+      // are now guaranteed to be suffixes
+      for (WordAff * p = exp_list; p; p = p->next)
+      {
+        // try the root word
+        unsigned sl_len;
+        sl = part.to_soundslike_temp(lang, p->word.str, p->word.size, &sl_len);
+        unsigned int limit = 0;
+        bool hit = false;
+        stopped_at = 0;
+        for (unsigned t = 0; t != num_targets; ++t) {
+          score = edit_dist_fun(sl, *targets[t].sls, parms->edit_distance_weights);
+          unsigned int s = score.stopped_at - sl;
+          s += p->word.size - sl_len;
+          if (s > limit) limit = s;
+          // reset s if necessary
           if (score < LARGE_NUM) {
-            commit_temp(sl);
-            ScoreInfo inf;
-            inf.soundslike = sl;
-            inf.soundslike_score = score;
-            add_nearmiss_a(i, p, inf);
+            s = LARGE_NUM;
+            if (!hit) part.add_word(t, *sw, p->word, sl, score);
+            else      part.add_again(t, score);
+            hit = true;
           }
+          if (s > stopped_at) stopped_at = s;
+        }
           
-          // expand any suffixes, using stopped_at as a hint to avoid
-          // unneeded expansions.  Note stopped_at is the last character
-          // looked at by limit_edit_dist.  Thus if the character
-          // at stopped_at is changed it might effect the result
-          // hence the "limit" is stopped_at + 1
-          if (p->word.size - lang->affix()->max_strip() > stopped_at)
-            exp_list = 0;
-          else
-            exp_list = lang->affix()->expand_suffix(p->word, p->aff, 
-                                                    temp_buffer, 
-                                                    stopped_at + 1);
-          
-          // reset stopped_at if necessary
-          if (score < LARGE_NUM) stopped_at = LARGE_NUM;
+        // expand any suffixes, using limit as a hint to avoid
+        // unneeded expansions.  Note limit is the last character
+        // looked at by limit_edit_dist.  Thus if the character
+        // at limit is changed it might effect the result
+        // hence the "limit" is limit + 1
+        if (p->word.size - lang->affix()->max_strip() > limit)
+          exp_list = 0;
+        else
+          exp_list = lang->affix()->expand_suffix(p->word, p->aff, 
+                                                  part.temp_buffer, 
+                                                  limit + 1);
           
-          // iterate through fully expanded words, if any
-          for (WordAff * q = exp_list; q; q = q->next) {
-            sl = to_soundslike_temp(q->word.str, q->word.size);
-            score = edit_dist_fun(sl, original_soundslike, parms->edit_distance_weights);
+        // iterate through fully expanded words, if any
+        for (WordAff * q = exp_list; q; q = q->next) {
+          sl = part.to_soundslike_temp(lang, q->word.str, q->word.size);
+          hit = false;
+          for (unsigned t = 0; t != num_targets; ++t) {
+            score = edit_dist_fun(sl, *targets[t].sls, parms->edit_distance_weights);
             if (score >= LARGE_NUM) continue;
-            commit_temp(sl);
-            ScoreInfo inf;
-            inf.soundslike = sl;
-            inf.soundslike_score = score;
-            add_nearmiss_a(i, q, inf);
+            if (!hit) part.add_word(t, *sw, q->word, sl, score);
+            else      part.add_again(t, score);
+            hit = true;
           }
         }
       }
     }
+    part.abort_temp();
+    part.stopped_at = stopped_at;
   }
 
-  void Working::try_scan_root() 
+  void Working::scan_root_part(ScanPart & part) const
   {
-
     WordEntry * sw;
-    WordEntry w;
     const char * sl = 0;
     EditDist score;
-    int stopped_at = LARGE_NUM;
-    GuessInfo gi;
-    lang->munch(original.word, &gi);
-    Vector<const char *> sls;
-    sls.push_back(original.soundslike.str());
-#ifdef DEBUG_SUGGEST
-    COUT.printf("will try soundslike: %s\n", sls.back());
-#endif
-    for (const aspeller::CheckInfo * ci = gi.head;
-         ci; 
-         ci = ci->next) 
-    {
-      sl = to_soundslike(ci->word.str, ci->word.len);
-      Vector<const char *>::iterator i = sls.begin();
-      while (i != sls.end() && strcmp(*i, sl) != 0) ++i;
-      if (i == sls.end()) {
-        sls.push_back(to_soundslike(ci->word.str, ci->word.len));
-#ifdef DEBUG_SUGGEST
-        COUT.printf("will try root soundslike: %s\n", sls.back());
-#endif
-      }
-    }
-    const char * * begin = sls.pbegin();
-    const char * * end   = sls.pend();
-    for (SpellerImpl::WS::const_iterator i = sp->suggest_ws.begin();
-         i != sp->suggest_ws.end();
-         ++i) 
-    {
-      StackPtr<SoundslikeEnumeration> els((*i)->soundslike_elements());
+    int stopped_at = part.stopped_at;
+    unsigned count = 0;
+    part.start_targets();
 
-      while ( (sw = els->next(stopped_at)) ) {
-          
-        if (sw->what != WordEntry::Word) {
-          sl = sw->word;
-          abort_temp();
-        } else {
-          sl = to_soundslike_temp(*sw);
-        } 
+    while ( (sw = part.els->next(stopped_at)) ) {
+
+      if ((++count & scan_check_mask) == 0 && out_of_time()) break;
 
-        stopped_at = LARGE_NUM;
-        for (const char * * s = begin; s != end; ++s) {
+      part.scanned = true;
+          
+      if (sw->what != WordEntry::Word) {
+        sl = sw->word;
+        part.abort_temp();
+      } else {
+        sl = part.to_soundslike_temp(lang, *sw);
+      } 
+
+      part.next_sl(sl);
+      bool hit = false;
+      stopped_at = part.skipped_hint();
+      unsigned * keep = part.active.pbegin();
+      for (unsigned * a = part.active.pbegin(), * e = part.active.pend(); 
+           a != e; ++a)
+      {
+        unsigned t = *a;
+        int target_stopped_at = LARGE_NUM;
+        for (const char * const * s = part.targets[t].sls; 
+             s != part.targets[t].sls_end; 
+             ++s) 
+        {
           score = edit_dist_fun(sl, *s, 
                                 parms->edit_distance_weights);
-          if (score.stopped_at - sl < stopped_at)
-            stopped_at = score.stopped_at - sl;
+          if (score.stopped_at - sl < target_stopped_at)
+            target_stopped_at = score.stopped_at - sl;
           if (score >= LARGE_NUM) continue;
-          stopped_at = LARGE_NUM;
-          commit_temp(sl);
-          add_sound(i, sw, sl, score);
+          target_stopped_at = LARGE_NUM;
+          if (!hit) part.add_sound(t, *sw, sl, score);
+          else      part.add_again(t, score);
+          hit = true;
           //CERR.printf("using %s: will add %s with score %d\n", *s, sl, (int)score);
           break;
         }
+        if (target_stopped_at == LARGE_NUM || !part.skip(t, target_stopped_at))
+          *keep++ = t;
+        if (target_stopped_at > stopped_at) stopped_at = target_stopped_at;
       }
+      part.active.resize(keep - part.active.pbegin());
     }
+    part.abort_temp();
+    part.stopped_at = stopped_at;
   }
 
   struct ReplTry 
@@ -1217,6 +1820,7 @@ namespace {
     Candidates candidates;
     int min_score = 0;
     int count = 0;
+    unsigned looked_at = 0;
 
     for (NearMisses::iterator i = scored_near_misses.begin();
          i != scored_near_misses.end(); ++i)
@@ -1227,13 +1831,15 @@ namespace {
     }
 
     for (SpellerImpl::WS::const_iterator i = sp->suggest_ws.begin();
-         i != sp->suggest_ws.end();
+         i != sp->suggest_ws.end() && !out_of_time();
          ++i) 
     {
       StackPtr<SoundslikeEnumeration> els((*i)->soundslike_elements());
       
       while ( (sw = els->next(LARGE_NUM)) ) {
 
+        if ((++looked_at & scan_check_mask) == 0 && out_of_time()) break;
+
         if (sw->what != WordEntry::Word) {
           abort_temp();
           sl = sw->word;
@@ -1241,13 +1847,14 @@ namespace {
           sl = to_soundslike_temp(sw->word, sw->word_size);
         }
         
-        if (already_have.have(sl)) continue;
+        const char * committed = committed_sl(sl, sw, *i);
+        if (committed && already_have.have(committed)) continue;
 
         int ng = ngram(3, original_soundslike.data(), original_soundslike.size(),
                        sl, strlen(sl));
 
         if (ng > 0 && ng >= min_score) {
-          commit_temp(sl);
+          sl = commit_sl(sl, sw, *i);
           candidates.push_back(NGramScore(i, *sw, sl, ng));
           if (ng > min_score) count++;
           if (count >= parms->ngram_keep) {
@@ -1299,6 +1906,11 @@ namespace {
     // this item will only be looked at when sorting so 
     // make it a small value to keep it at the front.
 
+    // once out of time what is already scored is used, the rest of
+    // the near misses are left as they are
+    bool stop = false;
+    unsigned count = 0;
+
     int try_for = (parms->word_weight*parms->edit_distance_weights.max)/100;
     while (true) {
       try_for += (parms->word_weight*parms->edit_distance_weights.max)/100;
@@ -1311,6 +1923,11 @@ namespace {
       ++i;
       while (i != near_misses.end()) {
 
+        if ((++count & score_check_mask) == 0 && out_of_time()) {
+          stop = true;
+          break;
+        }
+
         //CERR.printf("%s %s %s %d %d\n", i->word, i->word_clean, i->soundslike,
         //            i->word_score, i->soundslike_score);
 
@@ -1355,22 +1972,30 @@ namespace {
         prev = i;
         ++i;
       }
+
+      // sorting many near misses takes a while so do not try again
+      // if out of time
+      if (!stop) stop = out_of_time();
 	
       scored_near_misses.sort();
 	
       i = scored_near_misses.begin();
       ++i;
 	
-      if (i == scored_near_misses.end()) continue;
+      if (i == scored_near_misses.end()) {
+        if (stop) break;
+        continue;
+      }
 	
       int k = skip_first_couple(i);
 	
       if ((k == parms->skip && i->score <= try_for) 
-	  || prev == near_misses.begin() ) // or no more left in near_misses
+	  || prev == near_misses.begin() // or no more left in near_misses
+          || stop)
 	break;
     }
       
-    threshold = i->score + parms->span;
+    threshold = i != scored_near_misses.end() ? i->score + parms->span : 0;
     if (threshold < parms->edit_distance_weights.max)
       threshold = parms->edit_distance_weights.max;
 
@@ -1386,7 +2011,10 @@ namespace {
     prev = near_misses.begin();
     i = prev;
     ++i;
-    while (i != near_misses.end()) {
+    while (i != near_misses.end() && !stop) {
+
+      if ((++count & score_check_mask) == 0 && out_of_time()) 
+        break;
 	
       if (i->word_score >= LARGE_NUM) {
 
@@ -1452,45 +2080,66 @@ namespace {
 #  endif
   }
 
+  // returns the original word normalized for typo_edit_distance,
+  // stored in buf
+  ParmString Working::normalized_original(CharVector & buf) const {
+    unsigned int j;
+    buf.resize(original.word.size() + 1);
+    for (j = 0; j != original.word.size(); ++j)
+      buf[j] = parms->ti->to_normalized(original.word[j]);
+    buf[j] = 0;
+    return ParmString(buf.data(), j);
+  }
+
+  // Works out the scores fine_tune_score gives i when typo analysis
+  // is used, without changing i.  orig is the normalized_original
+  // and word a buffer with room for any near miss.
+  void Working::typo_scores(const ScoreWordSound & i, ParmString orig, 
+                            CharVector & word, int & word_score, 
+                            int & soundslike_score, int & adj_score) const
+  {
+    word_score = i.word_score;
+    soundslike_score = i.soundslike_score;
+    adj_score = i.adj_score;
+    SpecialTypoScore special = special_typo_score(*parms->ti, i.special_edit);
+    if (special) {
+      word_score = special.score;
+      soundslike_score = word_score;
+      adj_score = word_score;
+    }
+    if (adj_score >= LARGE_NUM) {
+      if (!special) {
+        unsigned int j;
+        for (j = 0; (i.word)[j] != 0; ++j)
+          word[j] = parms->ti->to_normalized((i.word)[j]);
+        word[j] = 0;
+        int new_score = typo_edit_distance(ParmString(word.data(), j), orig, *parms->ti);
+        // if a repl. table was used we don't want to increase the score
+        if (!i.repl_table || new_score < word_score)
+          word_score = new_score;
+      }
+      if (!special.is_overall_score) 
+        adj_score = adj_wighted_average(soundslike_score, word_score, parms->ti->max);
+    }
+  }
+
   void Working::fine_tune_score(int thres) {
 
     NearMisses::iterator i;
 
     if (parms->use_typo_analysis) {
       adj_threshold = 0;
-      unsigned int j;
       
       CharVector orig_norm, word;
-      orig_norm.resize(original.word.size() + 1);
-      for (j = 0; j != original.word.size(); ++j)
-        orig_norm[j] = parms->ti->to_normalized(original.word[j]);
-      orig_norm[j] = 0;
-      ParmString orig(orig_norm.data(), j);
+      ParmString orig = normalized_original(orig_norm);
       word.resize(max_word_length + 1);
       
       for (i = scored_near_misses.begin();
            i != scored_near_misses.end() && i->score <= thres;
            ++i)
       {
-        SpecialTypoScore special = special_typo_score(*parms->ti, i->special_edit);
-        if (special) {
-          i->word_score = special.score;
-          i->soundslike_score = i->word_score;
-          i->adj_score = i->word_score;
-        }
-        if (i->adj_score >= LARGE_NUM) {
-          if (!special) {
-            for (j = 0; (i->word)[j] != 0; ++j)
-              word[j] = parms->ti->to_normalized((i->word)[j]);
-            word[j] = 0;
-            int new_score = typo_edit_distance(ParmString(word.data(), j), orig, *parms->ti);
-            // if a repl. table was used we don't want to increase the score
-            if (!i->repl_table || new_score < i->word_score)
-              i->word_score = new_score;
-          }
-          if (!special.is_overall_score) 
-            i->adj_score = adj_wighted_average(i->soundslike_score, i->word_score, parms->ti->max);
-        }
+        typo_scores(*i, orig, word, 
+                    i->word_score, i->soundslike_score, i->adj_score);
         if (i->adj_score > adj_threshold)
           adj_threshold = i->adj_score;
       }
@@ -1564,18 +2213,19 @@ namespace {
             const char * pos = strchr(word, ' ');
             bool in_dict;
             if (pos == NULL)
-              in_dict = src->sp->check(word);
+              in_dict = src->sp->check_word(word);
             else
-              in_dict = src->sp->check(word, pos - word) && src->sp->check(pos + 1);
+              in_dict = src->sp->check_word(ParmString(word, pos - word))
+                && src->sp->check_word(pos + 1);
             if (in_dict)
-              res.push_back(Suggestion(word,&*i));
+              res.push_back(Suggestion(word,i->adj_score));
           }
         } while (i->repl_list->adv());
       } else {
         char * word = src->have_presuf ? src->fix_word(res.buf, i->word) : src->fix_case(i->word);
 	dup_pair = duplicates_check.insert(word);
 	if (dup_pair.second)
-          res.push_back(Suggestion(word,&*i));
+          res.push_back(Suggestion(word,i->adj_score));
       }
     }
     for (Vector<Working *>::iterator i = srcs.begin(), e = srcs.end(); i != e; ++i) {
@@ -1584,6 +2234,95 @@ namespace {
     res.saved_near_misses_.swap(scored_near_misses);
   }
   
+  // a near miss and the adj_score fine_tune_score would give it
+  struct PreviewItem {
+    const ScoreWordSound * near_miss;
+    int adj_score;
+  };
+
+  // the same order as adj_score_lt
+  static bool preview_lt(const PreviewItem & x, const PreviewItem & y)
+  {
+    int temp = x.adj_score - y.adj_score;
+    if (temp) return temp < 0;
+    temp = y.near_miss->frequency - x.near_miss->frequency;
+    if (temp) return temp < 0;
+    return strcmp(x.near_miss->word, y.near_miss->word) < 0;
+  }
+
+  // Works like finish and Sugs::transfer but leaves the near misses
+  // as they are so that the Workings can go on to the next step: the
+  // adj_scores are kept on the side and the words are copied before
+  // their case is fixed.
+  void Working::Steps::preview(SuggestionsImpl & res, int limit) const
+  {
+    res.reset();
+    Vector<PreviewItem> items;
+    CharVector orig_norm, word;
+    for (unsigned k = 0; k != ws_.size(); ++k) {
+      const Working * w = ws_[k];
+      NearMisses::const_iterator i = w->scored_near_misses.begin();
+      NearMisses::const_iterator end = w->scored_near_misses.end();
+      int adj_threshold = 0;
+      if (w->parms->use_typo_analysis) {
+        ParmString orig = w->normalized_original(orig_norm);
+        word.resize(w->max_word_length + 1);
+        for (; i != end && i->score <= w->threshold; ++i) {
+          int word_score, soundslike_score;
+          PreviewItem p = {&*i, 0};
+          w->typo_scores(*i, orig, word, word_score, soundslike_score, p.adj_score);
+          if (p.adj_score > adj_threshold)
+            adj_threshold = p.adj_score;
+          items.push_back(p);
+        }
+      } else {
+        for (; i != end && i->score <= w->threshold; ++i) {
+          PreviewItem p = {&*i, i->score};
+          items.push_back(p);
+        }
+        adj_threshold = w->threshold;
+      }
+      for (; i != end; ++i) {
+        PreviewItem p = {&*i, i->adj_score > adj_threshold ? LARGE_NUM : i->adj_score};
+        items.push_back(p);
+      }
+    }
+    std::stable_sort(items.begin(), items.end(), preview_lt);
+
+    StrHashSet duplicates_check;
+    for (Vector<PreviewItem>::const_iterator j = items.begin();
+         j != items.end() && res.size() < limit
+           && (j->adj_score < LARGE_NUM || res.size() < 3);
+         ++j)
+    {
+      const ScoreWordSound & i = *j->near_miss;
+      Working * src = i.src;
+      if (i.repl_list != 0) {
+        // a copy, as transfer uses up the near miss's own list
+        WordEntry repl = *i.repl_list;
+        do {
+          const char * word = src->fix_word(res.buf, repl.word);
+          if (!duplicates_check.insert(word).second) continue;
+          const char * pos = strchr(word, ' ');
+          bool in_dict;
+          if (pos == NULL)
+            in_dict = src->sp->check_word(word);
+          else
+            in_dict = src->sp->check_word(ParmString(word, pos - word))
+              && src->sp->check_word(pos + 1);
+          if (in_dict)
+            res.push_back(Suggestion(word, j->adj_score));
+        } while (repl.adv());
+      } else {
+        // with no prefix or suffix fix_word is a copy with the case
+        // fixed
+        const char * word = src->fix_word(res.buf, i.word);
+        if (duplicates_check.insert(word).second)
+          res.push_back(Suggestion(word, j->adj_score));
+      }
+    }
+  }
+
   class SuggestionListImpl : public SuggestionList {
     struct Parms {
       typedef const char *                    Value;
@@ -1610,36 +2349,241 @@ namespace {
     }
   };
 
+  //
+  // SuggestCache is a bounded cache of the final suggestion lists,
+  // the least recently used list is dropped first.  It is shared by
+  // all the SuggestImpls whose speller has the same main dictionary,
+  // thus the key of an entry is the word followed by everything else
+  // the suggestions depend on (see SuggestImpl::cache_key).  The
+  // cache does not keep a reference to the main dictionary as it is
+  // only ever compared with; the speller lets go of its cache before
+  // its dictionaries.
+  //
+
+  class SuggestCache : public Cacheable {
+  public:
+    typedef const Dictionary * CacheKey;
+    typedef const Config       CacheConfig;
+    static PosibErr<SuggestCache *> get_new(const CacheKey & main, 
+                                            const Config *) {
+      return new SuggestCache(main);
+    }
+    bool cache_key_eq(const CacheKey & main) const {return main_ == main;}
+
+    // on a hit copies the suggestions into res and returns true
+    bool lookup(const String & key, SuggestionsImpl & res);
+    // adds sugs, dropping the least recently used entries so that at
+    // most size are left
+    void insert(const String & key, const SuggestionsImpl & sugs, 
+                unsigned size);
+
+  private:
+    struct Entry;
+    typedef hash_map<String, Entry> Lookup;
+    typedef Lookup::value_type Node;
+    struct Entry {
+      String      words; // each followed by a null
+      Vector<int> scores;
+      Node *      newer;
+      Node *      older;
+      Entry() : newer(0), older(0) {}
+    };
+    const Dictionary * main_;
+    Mutex   lock_;
+    Lookup  lookup_;
+    Node *  newest_;
+    Node *  oldest_;
+    void unlink(Node *);
+    void link(Node *);
+    SuggestCache(const Dictionary * m) : main_(m), newest_(0), oldest_(0) {}
+    SuggestCache(const SuggestCache &);
+    void operator=(const SuggestCache &);
+  };
+
+  static GlobalCache<SuggestCache> suggest_cache("suggest");
+
+  // the options, besides sug-mode, the suggestions depend on for a
+  // given main dictionary
+  static const char * const cache_keys[] = {
+    "camel-case", "extra-dicts", "ignore", "ignore-case", "ignore-repl",
+    "keyboard", "personal-path", "repl-path", "run-together", 
+    "run-together-limit", "run-together-min", "sug-freq-stop",
+    "sug-repl-table", "sug-split-char", "sug-typo-analysis",
+    "use-other-dicts", "wordlists", 0
+  };
+
+  void SuggestCache::unlink(Node * n)
+  {
+    Entry & e = n->second;
+    (e.newer ? e.newer->second.older : newest_) = e.older;
+    (e.older ? e.older->second.newer : oldest_) = e.newer;
+    e.newer = e.older = 0;
+  }
+
+  void SuggestCache::link(Node * n)
+  {
+    n->second.older = newest_;
+    (newest_ ? newest_->second.newer : oldest_) = n;
+    newest_ = n;
+  }
+
+  bool SuggestCache::lookup(const String & key, SuggestionsImpl & res)
+  {
+    LOCK(&lock_);
+    Lookup::iterator i = lookup_.find(key);
+    if (i == lookup_.end()) return false;
+    Node * n = &*i;
+    if (n != newest_) {
+      unlink(n);
+      link(n);
+    }
+    const Entry & e = n->second;
+    res.reset();
+    const char * w = e.words.str();
+    for (Vector<int>::const_iterator j = e.scores.begin(), end = e.scores.end();
+         j != end; ++j) 
+    {
+      unsigned len = strlen(w);
+      res.push_back(Suggestion(res.buf.dup(ParmString(w, len)), *j));
+      w += len + 1;
+    }
+    return true;
+  }
+
+  void SuggestCache::insert(const String & key, const SuggestionsImpl & sugs,
+                            unsigned size)
+  {
+    LOCK(&lock_);
+    std::pair<Lookup::iterator, bool> res
+      = lookup_.insert(Node(key, Entry()));
+    Node * n = &*res.first;
+    if (!res.second) // another speller got there first
+      return;
+    Entry & e = n->second;
+    e.scores.reserve(sugs.size());
+    for (SuggestionsImpl::const_iterator i = sugs.begin(), end = sugs.end();
+         i != end; ++i)
+    {
+      e.words.append(i->word, strlen(i->word) + 1);
+      e.scores.push_back(i->score);
+    }
+    link(n);
+    while (lookup_.size() > size) {
+      Node * old = oldest_;
+      unlink(old);
+      lookup_.erase(lookup_.find(old->first));
+    }
+  }
+
   class SuggestImpl : public Suggest {
-    SpellerImpl * speller_;
+    const SpellerImpl * speller_;
     SuggestionListImpl  suggestion_list;
+    Vector<SuggestionListImpl *> batch_lists_;
+    unsigned            batch_size_;
     SuggestParms parms_;
+    CachePtr<SuggestCache> cache_;
+    String              cache_options_;
+    Deadline            deadline_;
+    bool                timed_out_;
+    // the steps of the word given to suggest_begin, null once done
+    StackPtr<Working::Steps> steps_;
+    String              steps_word_;
+    String              steps_key_; // the cache key when they began
+    SuggestionListImpl  steps_list_;
+    SuggestCache * cache();
+    void cache_key(const char * word, String & key);
+    void add_workings(const char * word, Vector<Working *> &);
+    Sugs * merge(Sugs * const * sugs, unsigned n);
+    void finish_steps();
+    SuggestImpl(const SuggestImpl &);
+    void operator=(const SuggestImpl &);
   public:
-    SuggestImpl(SpellerImpl * sp) : speller_(sp) {}
+    SuggestImpl(const SpellerImpl * sp) 
+      : speller_(sp), batch_size_(0), timed_out_(false) {}
+    ~SuggestImpl();
     PosibErr<void> setup(String mode = "");
     PosibErr<void> set_mode(ParmString mode) {
       return setup(mode);
     }
-    SuggestionList & suggest(const char * word);
+    Suggest * clone_setup() const;
+    SuggestionList & suggest(const char * word) {
+      return suggest(word, speller_->sug_deadline_us_);
+    }
+    SuggestionList & suggest(const char * word, long usecs);
+    bool timed_out() const {return timed_out_;}
     SuggestionsData & suggestions(const char * word);
+    void suggest_batch(const char * const * words, unsigned n);
+    SuggestionList * batch_suggestions(unsigned i);
+    SuggestionList & suggest_begin(const char * word);
+    SuggestionList & suggest_refine();
+    bool suggest_done() const {return !steps_;}
   };
+
+  SuggestImpl::~SuggestImpl()
+  {
+    for (Vector<SuggestionListImpl *>::iterator i = batch_lists_.begin(); 
+         i != batch_lists_.end(); ++i)
+      delete *i;
+  }
   
   PosibErr<void> SuggestImpl::setup(String mode)
   {
     if (mode == "") 
       mode = speller_->config()->retrieve("sug-mode");
     
+    // the Workings of an unfinished suggest_begin point to parms_
+    steps_.del();
+
     RET_ON_ERR(parms_.init(mode, speller_, speller_->config()));
 
+    cache_options_ = mode;
+    cache_options_ += '\0';
+    for (const char * const * i = cache_keys; *i; ++i) {
+      cache_options_ += speller_->config()->retrieve_any(*i).data;
+      cache_options_ += '\0';
+    }
+
     return no_err;
   }
 
-  SuggestionList & SuggestImpl::suggest(const char * word) { 
-#   ifdef DEBUG_SUGGEST
-    COUT << "=========== begin suggest " << word << " ===========\n";
-#   endif
-    Working * sug = new Working(speller_, &speller_->lang(),word, &parms_);
-    Sugs * sugs = sug->suggestions();
+  Suggest * SuggestImpl::clone_setup() const
+  {
+    SuggestImpl * s = new SuggestImpl(speller_);
+    s->parms_ = parms_;
+    s->cache_options_ = cache_options_;
+    return s;
+  }
+
+  // returns null if the cache is disabled
+  SuggestCache * SuggestImpl::cache()
+  {
+    if (speller_->sug_cache_size_ == 0) return 0;
+    if (!cache_) {
+      PosibErr<SuggestCache *> pe = get_cache_data(&suggest_cache, speller_->config(),
+                                                   speller_->main_dict());
+      cache_.reset(pe.data);
+    }
+    return cache_;
+  }
+
+  // The main dictionary is the same for all the users of the cache
+  // and the speller takes care of the other word lists and of any
+  // options changed after it was set up.
+  void SuggestImpl::cache_key(const char * word, String & key)
+  {
+    key = word;
+    key += '\0';
+    key += cache_options_;
+    speller_->sug_cache_key(key);
+  }
+
+  // Creates the Workings to suggest for word: one for the word itself
+  // and, if it is made of run-together words with only one of them
+  // incorrect, another for the incorrect one.
+  void SuggestImpl::add_workings(const char * word, Vector<Working *> & res)
+  {
+    res.push_back(new Working(speller_, &speller_->lang(), word, &parms_));
+    res.back()->with_deadline(&deadline_);
     CheckInfo ci[8];
     SpellerImpl::CompoundInfo cpi;
     String buf = word;
@@ -1648,21 +2592,165 @@ namespace {
     if (cpi.count > 1 && cpi.incorrect_count == 1) {
       CheckInfo * ci = cpi.first_incorrect;
       String prefix(str, ci->word.str - str), middle(ci->word.str, ci->word.len), suffix(ci->word.str + ci->word.len);
-      sug = new Working(speller_, &speller_->lang(), middle, &parms_);
+      Working * sug = new Working(speller_, &speller_->lang(), middle, &parms_);
       sug->camel_case = false;
       sug->with_presuf(prefix, suffix);
-      Sugs * sugs2 = sug->suggestions();
-      sugs->merge(*sugs2);
-      delete sugs2;
+      sug->with_deadline(&deadline_);
+      res.push_back(sug);
     }
-    sugs->transfer(suggestion_list.suggestions, parms_.limit);
-    delete sugs;
+  }
+
+  // merges the Sugs for the Workings add_workings created for a word
+  Sugs * SuggestImpl::merge(Sugs * const * sugs, unsigned n)
+  {
+    for (unsigned i = 1; i < n; ++i) {
+      sugs[0]->merge(*sugs[i]);
+      delete sugs[i];
+    }
+    return sugs[0];
+  }
+
+  SuggestionList & SuggestImpl::suggest(const char * word, long usecs) { 
+#   ifdef DEBUG_SUGGEST
+    COUT << "=========== begin suggest " << word << " ===========\n";
+#   endif
+    deadline_.set(usecs);
+    timed_out_ = false;
+    SuggestCache * c = cache();
+    String key;
+    if (c) {
+      cache_key(word, key);
+      if (c->lookup(key, suggestion_list.suggestions))
+        return suggestion_list;
+    }
+    Vector<Working *> ws;
+    add_workings(word, ws);
+    Sugs * sugs[2] = {0, 0};
+    for (unsigned i = 0; i != ws.size(); ++i)
+      sugs[i] = ws[i]->suggestions();
+    Sugs * res = merge(sugs, ws.size());
+    res->transfer(suggestion_list.suggestions, parms_.limit);
+    delete res;
+    // the suggestions may be incomplete if the time ran out so they
+    // are not cached
+    timed_out_ = deadline_.passed();
+    if (c && !timed_out_)
+      c->insert(key, suggestion_list.suggestions, speller_->sug_cache_size_);
 #   ifdef DEBUG_SUGGEST
     COUT << "^^^^^^^^^^^  end suggest " << word << "  ^^^^^^^^^^^\n";
 #   endif
     return suggestion_list;
   }
 
+  // Suggests for several words at once.  The result is the same as
+  // calling suggest for each but the dictionaries are only scanned
+  // once per step for all the words (see Working::suggestions).  Any
+  // deadline is for all the words together.
+  void SuggestImpl::suggest_batch(const char * const * words, unsigned n)
+  {
+    while (batch_lists_.size() < n)
+      batch_lists_.push_back(new SuggestionListImpl);
+
+    deadline_.set(speller_->sug_deadline_us_);
+
+    // the words found in the cache get no Workings
+    SuggestCache * c = cache();
+    Vector<String> keys(c ? n : 0);
+    Vector<Working *> ws;
+    Vector<unsigned> first(n + 1);
+    for (unsigned i = 0; i != n; ++i) {
+      first[i] = ws.size();
+      if (c) {
+        cache_key(words[i], keys[i]);
+        if (c->lookup(keys[i], batch_lists_[i]->suggestions)) continue;
+      }
+      add_workings(words[i], ws);
+    }
+    first[n] = ws.size();
+
+    Vector<Sugs *> sugs(ws.size());
+    Working::suggestions(ws.pbegin(), ws.size(), sugs.pbegin());
+    timed_out_ = deadline_.passed();
+
+    for (unsigned i = 0; i != batch_lists_.size(); ++i) {
+      if (i < n) {
+        if (first[i] == first[i + 1]) continue;
+        Sugs * res = merge(sugs.pbegin() + first[i], first[i + 1] - first[i]);
+        res->transfer(batch_lists_[i]->suggestions, parms_.limit);
+        delete res;
+        if (c && !timed_out_)
+          c->insert(keys[i], batch_lists_[i]->suggestions, 
+                    speller_->sug_cache_size_);
+      } else {
+        batch_lists_[i]->suggestions.reset();
+      }
+    }
+    batch_size_ = n;
+  }
+
+  // Suggests for word one step at a time, see Suggest::suggest_begin.
+  // The steps are not subject to any deadline as the caller decides
+  // how many to do.
+  SuggestionList & SuggestImpl::suggest_begin(const char * word)
+  {
+    steps_.del();
+    steps_word_ = word;
+    SuggestCache * c = cache();
+    if (c) {
+      cache_key(word, steps_key_);
+      if (c->lookup(steps_key_, steps_list_.suggestions))
+        return steps_list_;
+    }
+    Vector<Working *> ws;
+    add_workings(word, ws);
+    for (unsigned i = 0; i != ws.size(); ++i)
+      ws[i]->with_deadline(0);
+    steps_.reset(new Working::Steps(ws.pbegin(), ws.size()));
+    if (steps_->done())
+      finish_steps();
+    else
+      steps_->preview(steps_list_.suggestions, parms_.limit);
+    return steps_list_;
+  }
+
+  SuggestionList & SuggestImpl::suggest_refine()
+  {
+    if (!steps_) return steps_list_;
+    steps_->next();
+    if (steps_->done())
+      finish_steps();
+    else
+      steps_->preview(steps_list_.suggestions, parms_.limit);
+    return steps_list_;
+  }
+
+  // makes the final list for suggest_begin, the same one suggest
+  // would have made
+  void SuggestImpl::finish_steps()
+  {
+    Sugs * sugs[2] = {0, 0};
+    unsigned n = steps_->size();
+    steps_->finish(sugs);
+    steps_.del();
+    Sugs * res = merge(sugs, n);
+    res->transfer(steps_list_.suggestions, parms_.limit);
+    delete res;
+    // the word lists may have changed between the steps, in which
+    // case the list is a mix of before and after and is not cached
+    SuggestCache * c = cache();
+    if (c) {
+      String key;
+      cache_key(steps_word_.str(), key);
+      if (key == steps_key_)
+        c->insert(key, steps_list_.suggestions, speller_->sug_cache_size_);
+    }
+  }
+
+  SuggestionList * SuggestImpl::batch_suggestions(unsigned i)
+  {
+    return i < batch_size_ ? batch_lists_[i] : 0;
+  }
+
   SuggestionsData & SuggestImpl::suggestions(const char * word) {
     suggest(word);
     return suggestion_list.suggestions;
@@ -1670,13 +2758,13 @@ namespace {
 }
 
 namespace aspeller {
-  PosibErr<Suggest *> new_default_suggest(SpellerImpl * m) {
+  PosibErr<Suggest *> new_default_suggest(const SpellerImpl * m) {
     StackPtr<SuggestImpl> s(new SuggestImpl(m));
     RET_ON_ERR(s->setup());
     return s.release();
   }
 
-  PosibErr<void> SuggestParms::init(ParmString mode, SpellerImpl * sp) {
+  PosibErr<void> SuggestParms::init(ParmString mode, const SpellerImpl * sp) {
 
     edit_distance_weights.del1 =  95;
     edit_distance_weights.del2 =  95;
@@ -1705,6 +2793,9 @@ namespace aspeller {
     try_scan_2 = false;
     try_ngram = false;
     ngram_threshold = 2;
+    use_scan_index = false;
+    freq_stop = 0;
+    scan_threads = 1;
 
     if (mode == "ultra") {
       try_scan_0 = true;
@@ -1713,6 +2804,10 @@ namespace aspeller {
     } else if (mode == "normal") {
       try_scan_1 = true;
       try_scan_2 = true;
+    } else if (mode == "indexed") {
+      try_scan_1 = true;
+      try_scan_2 = true;
+      use_scan_index = true;
     } else if (mode == "slow") {
       try_scan_2 = true;
       try_ngram = true;
@@ -1727,7 +2822,7 @@ namespace aspeller {
       limit = 1000;
       ngram_threshold = 1;
     } else {
-      return make_err(bad_value, "sug-mode", mode, _("one of ultra, fast, normal, slow, or bad-spellers"));
+      return make_err(bad_value, "sug-mode", mode, _("one of ultra, fast, normal, indexed, slow, or bad-spellers"));
     }
 
     if (!sp->have_soundslike) {
@@ -1745,7 +2840,8 @@ namespace aspeller {
     return no_err;
   }
 
-  PosibErr<void> SuggestParms::init(ParmString mode, SpellerImpl * sp, Config * config) {
+  PosibErr<void> SuggestParms::init(ParmString mode, const SpellerImpl * sp,
+                                    const Config * config) {
     RET_ON_ERR(init(mode,sp));
 
     if (config->have("sug-typo-analysis"))
@@ -1753,6 +2849,11 @@ namespace aspeller {
     if (config->have("sug-repl-table"))
       use_repl_table = config->retrieve_bool("sug-repl-table");
 
+    freq_stop = config->retrieve_int("sug-freq-stop");
+
+    int threads = config->retrieve_int("sug-scan-threads");
+    scan_threads = threads < 1 ? 1 : threads > 64 ? 64 : threads;
+
     camel_case = config->retrieve_bool("camel-case");
     if (camel_case)
       split_chars.clear();
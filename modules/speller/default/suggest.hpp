@@ -33,12 +33,37 @@ namespace aspeller {
   class Suggest {
   public:
     virtual PosibErr<void> set_mode(ParmString) = 0;
+    // returns a new Suggest with the same mode and options but none
+    // of the suggestions, set up without reading the config so that
+    // several threads may call it at once
+    virtual Suggest * clone_setup() const = 0;
     virtual SuggestionList & suggest(const char * word) = 0;
+    // like suggest(word) but gives up after usecs microseconds, if
+    // more than 0, returning the best suggestions found by then
+    virtual SuggestionList & suggest(const char * word, long usecs) = 0;
+    // true if the last call to suggest or suggest_batch ran out of
+    // time
+    virtual bool timed_out() const = 0;
     virtual SuggestionsData & suggestions(const char * word) = 0;
+    // finds the suggestions for several words at once, which are
+    // then returned by batch_suggestions until the next call
+    virtual void suggest_batch(const char * const * words, unsigned n) = 0;
+    // returns null if i is not less than n
+    virtual SuggestionList * batch_suggestions(unsigned i) = 0;
+    // Suggests for word a step at a time.  suggest_begin returns the
+    // suggestions from the quick steps, the replacement table, one
+    // edit and splitting the word, and each call to suggest_refine
+    // does the next step, such as a scan of the dictionaries, and
+    // returns the suggestions found so far.  Once suggest_done the
+    // list is the one suggest would return.  The list is only valid
+    // until the next call to either.
+    virtual SuggestionList & suggest_begin(const char * word) = 0;
+    virtual SuggestionList & suggest_refine() = 0;
+    virtual bool suggest_done() const = 0;
     virtual ~Suggest() {}
   };
 
-  PosibErr<Suggest *> new_default_suggest(SpellerImpl *);
+  PosibErr<Suggest *> new_default_suggest(const SpellerImpl *);
 
 }
 
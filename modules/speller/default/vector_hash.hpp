@@ -226,6 +226,11 @@ namespace aspeller {
 
     iterator find(const key_type&);
     const_iterator find(const key_type&) const;
+
+    // the first slot find will look at
+    const value_type * first_slot(const key_type & k) const {
+      return &vector_[hash1(k)];
+    }
   
     size_type erase(const key_type &key);
     void erase(const iterator &p);
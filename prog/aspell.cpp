@@ -666,7 +666,8 @@ struct StatusFunInf
   aspeller::SpellerImpl * real_speller;
   Conv oconv;
   bool verbose;
-  StatusFunInf(Convert * c) : oconv(c) {}
+  OStream * out;
+  StatusFunInf(Convert * c) : oconv(c), out(&COUT) {}
 };
 
 void status_fun(void * d, Token, int correct)
@@ -675,11 +676,11 @@ void status_fun(void * d, Token, int correct)
   if (p->verbose && correct) {
     const CheckInfo * ci = p->real_speller->check_info();
     if (ci->compound)
-      COUT.put("-\n");
+      p->out->put("-\n");
     else if (ci->pre_flag || ci->suf_flag)
-      COUT.printf("+ %s\n", p->oconv(ci->word.str, ci->word.len));
+      p->out->printf("+ %s\n", p->oconv(ci->word.str, ci->word.len));
     else
-      COUT.put("*\n");
+      p->out->put("*\n");
   }
 }
 
@@ -697,6 +698,14 @@ DocumentChecker * new_checker(AspellSpeller * speller,
     print_error(aspell_speller_error_message(speller)); break;\
   } } while (false)
 
+// a misspelling found by pipe
+struct Misspelling {
+  String before; // the status of the correct words before it
+  char * word;
+  unsigned offset;
+  String guesses;
+};
+
 void pipe() 
 {
   line_buffer();
@@ -705,6 +714,7 @@ void pipe()
   bool do_time = options->retrieve_bool("time");
   bool suggest = options->retrieve_bool("suggest");
   bool include_guesses = options->retrieve_bool("guess");
+  int deadline_us = options->retrieve_int("sug-deadline-us");
   clock_t start,finish;
 
   if (!options->have("mode") && !options->have("filter")) {
@@ -728,6 +738,8 @@ void pipe()
   Conv iconv(setup_conv(config, &real_speller->lang()));
   Conv oconv(setup_conv(&real_speller->lang(), config));
   MBLen mb_len;
+  Vector<Misspelling> misspellings;
+  String pending;
   if (!config->retrieve_bool("byte-offsets")) 
     mb_len.setup(*config, config->retrieve("encoding"));
   if (do_time)
@@ -737,6 +749,10 @@ void pipe()
   status_fun_inf.real_speller = real_speller;
   bool & print_star = status_fun_inf.verbose;
   print_star = true;
+  // the status of the correct words is held back so that it comes out
+  // in order with the misspellings, which are only printed once they
+  // have all been found so that they can be suggested for at once
+  status_fun_inf.out = &pending;
   StackPtr<DocumentChecker> checker(new_checker(speller, status_fun_inf));
   int c;
   const char * w;
@@ -832,6 +848,8 @@ void pipe()
               do_time = config->retrieve_bool("time");
             else if (strcmp(word,"guess") == 0)
               include_guesses = config->retrieve_bool("guess");
+            else if (strcmp(word,"sug-deadline-us") == 0)
+              deadline_us = config->retrieve_int("sug-deadline-us");
 	    break;
 	  case 'r':
 	    word = trim_wspace(line + 4);
@@ -864,11 +882,18 @@ void pipe()
       line0 = line;
       line += ignore;
       checker->process(line, strlen(line));
+      misspellings.clear();
       while (Token token = checker->next_misspelling()) {
 	word = line + token.offset;
 	word[token.len] = '\0';
+        misspellings.push_back(Misspelling());
+        Misspelling & mis = misspellings.back();
+        mis.before.swap(pending);
+        mis.word = word;
+        mis.offset = mb_len(line0, token.offset + ignore);
         const char * cword = iconv(word);
-        String guesses, guess;
+        String & guesses = mis.guesses;
+        String guess;
         const CheckInfo * ci = real_speller->check_info();
         aspeller::CasePattern casep 
           = real_speller->lang().case_pattern(cword);
@@ -889,12 +914,32 @@ void pipe()
           guesses << ", " << oconv(guess.str());
           ci = ci->next;
         }
+      }
+      // suggest for all the misspellings of the line at once, unless
+      // the time for each one is wanted or limited, as a batch has a
+      // single deadline for all of its words
+      bool batch = suggest && !do_time && deadline_us <= 0
+        && misspellings.size() > 1;
+      if (batch) {
+        Vector<const char *> words;
+        for (unsigned i = 0; i != misspellings.size(); ++i)
+          words.push_back(misspellings[i].word);
+        if (aspell_speller_suggest_batch(speller, words.pbegin(), NULL, 
+                                         words.size()) < 0)
+          batch = false;
+      }
+      for (unsigned i = 0; i != misspellings.size(); ++i) {
+        COUT.put(misspellings[i].before);
+        word = misspellings[i].word;
+        unsigned offset = misspellings[i].offset;
+        const String & guesses = misspellings[i].guesses;
 	start = clock();
         const AspellWordList * suggestions = 0;
-        if (suggest) 
+        if (batch)
+          suggestions = aspell_speller_batch_suggestions(speller, i);
+        else if (suggest) 
           suggestions = aspell_speller_suggest(speller, word, -1);
 	finish = clock();
-        unsigned offset = mb_len(line0, token.offset + ignore);
 	if (suggestions && !aspell_word_list_empty(suggestions)) 
         {
           COUT.printf("& %s %u %u:", word, 
@@ -934,6 +979,8 @@ void pipe()
           COUT.printf(_("Suggestion Time: %f\n"), 
                       (finish-start)/(double)CLOCKS_PER_SEC);
       }
+      COUT.put(pending);
+      pending.clear();
       COUT.put('\n');
     }
     if (c == EOF) break;
@@ -0,0 +1,131 @@
+// Checks that spell checking words and documents does not allocate
+// any memory once the speller is warmed up.
+//
+// Must be linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+// against the static library so that every allocation made by Aspell
+// goes through the counters below.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include <aspell.h>
+
+extern "C" {
+  void * __real_malloc(size_t);
+  void * __real_calloc(size_t, size_t);
+  void * __real_realloc(void *, size_t);
+}
+
+static unsigned long allocs = 0;
+
+extern "C" void * __wrap_malloc(size_t sz) {
+  ++allocs;
+  return __real_malloc(sz);
+}
+extern "C" void * __wrap_calloc(size_t n, size_t sz) {
+  ++allocs;
+  return __real_calloc(n, sz);
+}
+extern "C" void * __wrap_realloc(void * p, size_t sz) {
+  ++allocs;
+  return __real_realloc(p, sz);
+}
+
+void * operator new(size_t sz) {
+  void * p = malloc(sz ? sz : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void * operator new[](size_t sz) {return operator new(sz);}
+void operator delete(void * p) throw() {free(p);}
+void operator delete[](void * p) throw() {free(p);}
+void operator delete(void * p, size_t) throw() {free(p);}
+void operator delete[](void * p, size_t) throw() {free(p);}
+
+const char * test_words[] = {
+  "the", "The", "THE", "cat", "cats", "cat's", "walked", "unwalked",
+  "teh", "Teh", "mispeled", "catsdog", "swimmerthe", "a", "I",
+  "supercalifragilisticexpialidocious", 0
+};
+
+const char * test_doc =
+  "The quick brown fox jumpped over teh lazy dog's back, "
+  "and the catsdog watched in wonder.";
+
+int fail = 0;
+
+AspellSpeller * new_speller(const char * name, const char * value) {
+  AspellConfig * config = new_aspell_config();
+  aspell_config_replace(config, "lang", "en_US");
+  if (name)
+    aspell_config_replace(config, name, value);
+  AspellCanHaveError * possible_err = new_aspell_speller(config);
+  delete_aspell_config(config);
+  if (aspell_error_number(possible_err) != 0) {
+    fprintf(stderr, "%s\n", aspell_error_message(possible_err));
+    exit(2);
+  }
+  return to_aspell_speller(possible_err);
+}
+
+int check_words(AspellSpeller * speller) {
+  int num_correct = 0;
+  for (const char * * w = test_words; *w; ++w)
+    num_correct += aspell_speller_check(speller, *w, -1);
+  return num_correct;
+}
+
+int check_doc(AspellDocumentChecker * checker) {
+  int num_misspelled = 0;
+  aspell_document_checker_process(checker, test_doc, -1);
+  while (aspell_document_checker_next_misspelling(checker).len != 0)
+    ++num_misspelled;
+  return num_misspelled;
+}
+
+void test(const char * name, const char * value) {
+  AspellSpeller * speller = new_speller(name, value);
+  AspellCanHaveError * possible_err = new_aspell_document_checker(speller);
+  if (aspell_error_number(possible_err) != 0) {
+    fprintf(stderr, "%s\n", aspell_error_message(possible_err));
+    exit(2);
+  }
+  AspellDocumentChecker * checker = to_aspell_document_checker(possible_err);
+
+  int num_correct = check_words(speller);
+  int num_misspelled = check_doc(checker);
+
+  unsigned long before = allocs;
+  for (int i = 0; i != 10; ++i) {
+    if (check_words(speller) != num_correct
+        || check_doc(checker) != num_misspelled) {
+      fprintf(stderr, "fail: results changed between passes (%s)\n",
+              name ? name : "default");
+      fail = 1;
+    }
+  }
+  unsigned long num_allocs = allocs - before;
+  if (num_allocs != 0) {
+    fprintf(stderr, "fail: %lu allocations while checking (%s)\n",
+            num_allocs, name ? name : "default");
+    fail = 1;
+  }
+
+  delete_aspell_document_checker(checker);
+  delete_aspell_speller(speller);
+}
+
+int main() {
+  test(0, 0);
+  test("run-together", "true");
+  test("check-cache-size", "64");
+  if (fail) {
+    printf("not ok\n");
+    return 1;
+  } else {
+    printf("ok\n");
+    return 0;
+  }
+}
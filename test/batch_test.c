@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aspell.h>
+
+/* Checks that check_batch and suggest_batch give the same results as
+   check and suggest and that a negative number of words is an
+   error. */
+
+const char * test_words[] = {
+  "the", "cats", "walked", "swimmer", "teh", "recieve", "swimer",
+  "diagree", "noone", "thier", "seperate", "untill", "wich", 0
+};
+
+int fail = 0;
+
+static void get_words(const AspellWordList * list, char * buf, size_t size) {
+  AspellStringEnumeration * elements = aspell_word_list_elements(list);
+  const char * word;
+  buf[0] = '\0';
+  while ( (word = aspell_string_enumeration_next(elements)) != NULL ) {
+    if (strlen(buf) + strlen(word) + 2 > size) break;
+    strcat(buf, word);
+    strcat(buf, ",");
+  }
+  delete_aspell_string_enumeration(elements);
+}
+
+int main() {
+  static char expected[8192], got[8192];
+  int n, i, num_correct, res;
+  int results[sizeof(test_words)/sizeof(test_words[0])];
+  AspellConfig * spell_config = new_aspell_config();
+  aspell_config_replace(spell_config, "master", "en_US");
+  AspellCanHaveError * possible_err = new_aspell_speller(spell_config);
+  delete_aspell_config(spell_config);
+  if (aspell_error_number(possible_err) != 0) {
+    fprintf(stderr, "%s", aspell_error_message(possible_err));
+    return 2;
+  }
+  AspellSpeller * spell_checker = to_aspell_speller(possible_err);
+
+  for (n = 0; test_words[n]; ++n)
+    results[n] = -1;
+  res = aspell_speller_check_batch(spell_checker, test_words, NULL, n, results);
+  num_correct = 0;
+  for (i = 0; i != n; ++i) {
+    int correct = aspell_speller_check(spell_checker, test_words[i], -1);
+    if (results[i] != correct) {
+      fprintf(stderr, "fail: %s: check_batch gave %d but check %d\n",
+              test_words[i], results[i], correct);
+      fail = 1;
+    }
+    num_correct += correct;
+  }
+  if (res != num_correct) {
+    fprintf(stderr, "fail: check_batch returned %d but %d are correct\n",
+            res, num_correct);
+    fail = 1;
+  }
+
+  if (aspell_speller_check_batch(spell_checker, test_words, NULL, 0, results) != 0) {
+    fprintf(stderr, "%s", "fail: expected no correct words in an empty batch\n");
+    fail = 1;
+  }
+
+  res = aspell_speller_check_batch(spell_checker, test_words, NULL, -1, results);
+  if (res != -1 || aspell_speller_error_number(spell_checker) == 0) {
+    fprintf(stderr, "%s", "fail: expected an error for a negative number of words\n");
+    fail = 1;
+  }
+
+  if (aspell_speller_suggest_batch(spell_checker, test_words, NULL, n) != n) {
+    fprintf(stderr, "fail: suggest_batch: %s\n",
+            aspell_speller_error_message(spell_checker));
+    fail = 1;
+  }
+  for (i = 0; i != n; ++i) {
+    const AspellWordList * sugs = aspell_speller_batch_suggestions(spell_checker, i);
+    if (!sugs) {
+      fprintf(stderr, "fail: %s: no batch suggestions\n", test_words[i]);
+      fail = 1;
+      continue;
+    }
+    get_words(sugs, got, sizeof(got));
+    get_words(aspell_speller_suggest(spell_checker, test_words[i], -1),
+              expected, sizeof(expected));
+    if (strcmp(got, expected) != 0) {
+      fprintf(stderr, "fail: %s: suggest gave \"%s\" but suggest_batch \"%s\"\n",
+              test_words[i], expected, got);
+      fail = 1;
+    }
+  }
+
+  res = aspell_speller_suggest_batch(spell_checker, test_words, NULL, -1);
+  if (res != -1 || aspell_speller_error_number(spell_checker) == 0) {
+    fprintf(stderr, "%s", "fail: expected an error for a negative number of words to suggest for\n");
+    fail = 1;
+  }
+  if (aspell_speller_batch_suggestions(spell_checker, 0)) {
+    fprintf(stderr, "%s", "fail: expected no batch suggestions after an error\n");
+    fail = 1;
+  }
+
+  delete_aspell_speller(spell_checker);
+  return fail;
+}
@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aspell.h>
+
+/* Checks that warm works and that dict_memory_usage gives a sensible
+   size and resident size for each dictionary it reports. */
+
+int fail = 0;
+
+int main() {
+  AspellConfig * spell_config = new_aspell_config();
+  aspell_config_replace(spell_config, "master", "en_US");
+  AspellCanHaveError * possible_err = new_aspell_speller(spell_config);
+  delete_aspell_config(spell_config);
+  if (aspell_error_number(possible_err) != 0) {
+    fprintf(stderr, "%s", aspell_error_message(possible_err));
+    return 2;
+  }
+  AspellSpeller * spell_checker = to_aspell_speller(possible_err);
+
+  if (!aspell_speller_warm(spell_checker)) {
+    fprintf(stderr, "fail: warm: %s\n", aspell_speller_error_message(spell_checker));
+    fail = 1;
+  }
+
+  AspellStringPairEnumeration * usage
+    = aspell_speller_dict_memory_usage(spell_checker);
+  while (!aspell_string_pair_enumeration_at_end(usage)) {
+    AspellStringPair p = aspell_string_pair_enumeration_next(usage);
+    unsigned long size, resident;
+    if (sscanf(p.second, "%lu %lu", &size, &resident) != 2
+        || size == 0 || resident > size) {
+      fprintf(stderr, "fail: %s: bad usage \"%s\"\n", p.first, p.second);
+      fail = 1;
+    }
+  }
+  delete_aspell_string_pair_enumeration(usage);
+
+  if (!aspell_speller_check(spell_checker, "swimmer", -1)) {
+    fprintf(stderr, "%s", "fail: expected word to be correct after warm\n");
+    fail = 1;
+  }
+
+  delete_aspell_speller(spell_checker);
+  return fail;
+}
@@ -0,0 +1,318 @@
+// Times EditDistancePattern, the bit-parallel lower bound on the
+// number of edits between two words, against limit_edit_distance
+// and edit_distance, the functions it would save calls to when
+// scoring suggestions.  Also checks that using the bound never
+// changes a score.
+//
+// Usage: editdist_bench [rounds | check]
+//
+// With "check" only the scores are checked, nothing is timed.
+//
+// The bound is not used by the library: suggesting for real
+// misspellings took the same time with and without it, so it only
+// lives here.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "editdist2.hpp"
+
+using namespace aspeller;
+
+// EditDistancePattern finds a lower bound on the number of edits
+// limit_edit_distance needs to turn the word it was set up with
+// into another word, using Hyyrö's bit-parallel version of Myers'
+// algorithm which also allows swaps.  The edits are the same as
+// for limit_edit_distance: deleting or inserting a char,
+// substituting one char for another and swapping two adjacent
+// chars.  Since limit_edit_distance deletes whatever is left of
+// one word once the other runs out without counting it against
+// the limit, the bound is the least number of edits needed to turn
+// all of one word into some prefix of the other.
+
+// Preconditions:
+//   the word set up with is at most 64 chars long, otherwise
+//   usable() is false and min_edits may not be called
+
+// The running time of min_edits is linear in the length of the
+// other word as a 64 bit integer holds a whole column of the edit
+// distance matrix.  It is about the same as limit_edit_distance
+// with a limit of 2 or 3.
+
+class EditDistancePattern {
+public:
+  EditDistancePattern() : size_(0) {}
+  void init(ParmString word);
+  bool usable() const {return size_ != 0;}
+  // returns the bound, or as soon as it is known to be at most
+  // "enough" any number not larger than that
+  int min_edits(const char * other, int enough = 0) const;
+private:
+  unsigned size_;
+  uint64_t eq_[256]; // for each char the positions of it in the word
+};
+
+// the most edits limit_edit_distance, or limit2_edit_distance, may
+// make with a limit of "level" before one of the words runs out
+static inline int limit_max_edits(int level, const EditDistanceWeights & w)
+{
+  if (w.min <= 0) return LARGE_NUM;
+  return (level - 1) * w.max / w.min + 1;
+}
+
+// See "A Bit-Vector Algorithm for Computing Levenshtein and Damerau
+// Edit Distances" by Heikki Hyyrö (2003).  The vertical (vp, vn) and
+// horizontal (hp, hn) vectors hold whether the differences between
+// adjacent cells of the edit distance matrix are +1 or -1, bit i
+// being row i+1 of the current column.
+
+void EditDistancePattern::init(ParmString word)
+{
+  size_ = 0;
+  if (word.size() == 0 || word.size() > 64) return;
+  memset(eq_, 0, sizeof(eq_));
+  for (unsigned i = 0; i != word.size(); ++i)
+    eq_[static_cast<unsigned char>(word[i])] |= (uint64_t)1 << i;
+  size_ = word.size();
+}
+
+int EditDistancePattern::min_edits(const char * other, int enough) const
+{
+  const uint64_t last = (uint64_t)1 << (size_ - 1);
+  uint64_t vp = ~(uint64_t)0, vn = 0, d0 = 0, prev_eq = 0;
+  int dist = size_;
+  int min = dist;
+  if (min <= enough) return min;
+
+  // the last row: the edits to turn the word into each prefix of
+  // other
+  const unsigned char * i = reinterpret_cast<const unsigned char *>(other);
+  for (; *i; ++i) {
+    uint64_t eq = eq_[*i];
+    uint64_t tr = ((~d0 & eq) << 1) & prev_eq;
+    d0 = (((eq & vp) + vp) ^ vp) | eq | vn | tr;
+    uint64_t hp = vn | ~(d0 | vp);
+    uint64_t hn = d0 & vp;
+    if (hp & last) ++dist;
+    if (hn & last) --dist;
+    if (dist < min) {
+      if (dist <= enough) return dist;
+      min = dist;
+    }
+    hp = (hp << 1) | 1;
+    hn = hn << 1;
+    vp = hn | ~(d0 | hp);
+    vn = hp & d0;
+    prev_eq = eq;
+  }
+
+  // the last column: the edits to turn each prefix of the word into
+  // other.  Turning the first r chars of the word into the n chars
+  // of other takes at least n - r edits so only the rows after
+  // n - min can need fewer than min.  They are walked up from the
+  // last one, whose value is dist.
+  int n = i - reinterpret_cast<const unsigned char *>(other);
+  int top = n - min + 1;
+  for (int r = size_; r > top && r > 0; --r) {
+    dist -= (int)(vp >> (r - 1) & 1) - (int)(vn >> (r - 1) & 1);
+    if (dist < min) min = dist;
+  }
+
+  return min;
+}
+
+// the same as edit_distance from editdist2.hpp except that the
+// levels at which p, set up with a, shows that b can not be reached
+// are skipped without trying them.  Up to a limit of 3 limit_edit_distance usually costs less
+// than finding the bound so it is only used for larger limits.
+inline int edit_distance(const EditDistancePattern & p,
+                         ParmString a, ParmString b,
+                         int level, int limit,
+                         const EditDistanceWeights & w)
+{
+  if (limit >= 4 && level < 5 && p.usable()) {
+    int edits = p.min_edits(b.str(), limit_max_edits(level, w));
+    while (level < 5 && limit_max_edits(level, w) < edits) {
+      if (level == limit) return LARGE_NUM;
+      ++level;
+    }
+  }
+  return edit_distance(a, b, level, limit, w);
+}
+
+static const char letters[] = "eeeeeeeeettttttaaaaaaoooooiiiiiinnnnnnsssss"
+                              "hhhhhrrrrrddddllllcccuuummwwffggyyppbbvkjxqz";
+
+static unsigned long seed = 1;
+static unsigned rnd(unsigned n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+static char rnd_letter()
+{
+  return letters[rnd(sizeof(letters) - 1)];
+}
+
+static void make_word(char * w)
+{
+  unsigned len = 3 + rnd(10);
+  for (unsigned i = 0; i != len; ++i)
+    w[i] = rnd_letter();
+  w[len] = '\0';
+}
+
+// applies num random edits to w, which must have room for num more
+// chars
+static void edit_word(char * w, unsigned num)
+{
+  for (unsigned k = 0; k != num; ++k) {
+    unsigned len = strlen(w);
+    unsigned p = rnd(len + 1);
+    switch (rnd(4)) {
+    case 0: // insert
+      memmove(w + p + 1, w + p, len - p + 1);
+      w[p] = rnd_letter();
+      break;
+    case 1: // delete
+      if (p < len) memmove(w + p, w + p + 1, len - p);
+      break;
+    case 2: // substitute
+      if (p < len) w[p] = rnd_letter();
+      break;
+    case 3: // swap
+      if (p + 1 < len) {char c = w[p]; w[p] = w[p + 1]; w[p + 1] = c;}
+      break;
+    }
+  }
+}
+
+static const unsigned num_words = 200;
+static const unsigned num_cands = 50;
+
+struct Word {
+  char word[32];
+  char cands[num_cands][40];
+};
+
+static double now()
+{
+  return double(clock()) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, const char * argv[])
+{
+  bool timed = !(argc > 1 && strcmp(argv[1], "check") == 0);
+  unsigned rounds = timed ? (argc > 1 ? atoi(argv[1]) : 20) : 0;
+
+  EditDistanceWeights w;
+  w.del1 = 95;
+  w.del2 = 95;
+  w.swap = 90;
+  w.sub = 100;
+  w.similar = 10;
+  w.max = 100;
+  w.min = 90;
+
+  // candidates are mostly a few edits away from the word, like the
+  // near misses found by a soundslike scan, with some unrelated words
+  Word * words = new Word[num_words];
+  for (unsigned i = 0; i != num_words; ++i) {
+    make_word(words[i].word);
+    for (unsigned j = 0; j != num_cands; ++j) {
+      char * c = words[i].cands[j];
+      if (rnd(5) == 0) {
+        make_word(c);
+      } else {
+        strcpy(c, words[i].word);
+        edit_word(c, rnd(6));
+      }
+    }
+  }
+
+  EditDistancePattern p;
+  unsigned pairs = num_words * num_cands;
+  bool ok = true;
+
+  static const int ranges[][2] = {{1,1}, {2,2}, {3,3}, {4,4}, {1,3}, {2,4}};
+
+  if (timed)
+    printf("%-6s %12s %12s %12s %8s\n", "levels", "plain ns", "pattern ns",
+           "bound ns", "skipped");
+  for (unsigned k = 0; k != sizeof(ranges)/sizeof(ranges[0]); ++k) {
+    int level = ranges[k][0], limit = ranges[k][1];
+    long sum1 = 0, sum2 = 0;
+    unsigned skipped = 0;
+
+    double t0 = now();
+    for (unsigned r = 0; r != rounds; ++r)
+      for (unsigned i = 0; i != num_words; ++i)
+        for (unsigned j = 0; j != num_cands; ++j)
+          sum1 += edit_distance(words[i].word, words[i].cands[j],
+                                level, limit, w);
+
+    double t1 = now();
+    for (unsigned r = 0; r != rounds; ++r)
+      for (unsigned i = 0; i != num_words; ++i) {
+        p.init(words[i].word);
+        for (unsigned j = 0; j != num_cands; ++j)
+          sum2 += edit_distance(p, words[i].word, words[i].cands[j],
+                                level, limit, w);
+      }
+
+    double t2 = now();
+    int enough = limit_max_edits(level, w);
+    for (unsigned r = 0; r != rounds; ++r)
+      for (unsigned i = 0; i != num_words; ++i) {
+        p.init(words[i].word);
+        for (unsigned j = 0; j != num_cands; ++j)
+          if (p.min_edits(words[i].cands[j], enough) > limit_max_edits(limit, w))
+            ++skipped;
+      }
+    double t3 = now();
+
+    for (unsigned i = 0; i != num_words; ++i) {
+      p.init(words[i].word);
+      for (unsigned j = 0; j != num_cands; ++j) {
+        const char * a = words[i].word;
+        const char * b = words[i].cands[j];
+        int s1 = edit_distance(a, b, level, limit, w);
+        int s2 = edit_distance(p, a, b, level, limit, w);
+        if (s1 != s2) {
+          printf("%d-%d: \"%s\" \"%s\": %d != %d\n", level, limit, a, b, s1, s2);
+          ok = false;
+        }
+      }
+    }
+
+    if (sum1 != sum2) ok = false;
+    if (!timed) continue;
+    double n = double(pairs) * rounds / 1e9;
+    printf("%d-%-4d %12.1f %12.1f %12.1f %7.1f%%\n", level, limit,
+           (t1 - t0) / n, (t2 - t1) / n, (t3 - t2) / n,
+           100.0 * skipped / pairs / rounds);
+  }
+
+  // from level 5 on edit_distance does the full computation
+  if (timed) {
+    long sum = 0;
+    double t0 = now();
+    for (unsigned r = 0; r != rounds; ++r)
+      for (unsigned i = 0; i != num_words; ++i)
+        for (unsigned j = 0; j != num_cands; ++j)
+          sum += edit_distance(words[i].word, words[i].cands[j], w);
+    double t1 = now();
+    printf("%-6s %12.1f\n", "full", (t1 - t0) / (double(pairs) * rounds / 1e9));
+  }
+
+  delete[] words;
+  if (!ok) {
+    printf("the bound changed a score\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aspell.h>
+
+/* Checks that suggesting a step at a time with suggest_begin and
+   suggest_refine ends with the same list as suggest, and that a list
+   made while a word was added to the session is not cached. */
+
+const char * const test_words[] = {
+  "recieve", "teh", "diagree", "noone", "swimer", "thier", "acommodate",
+  "definately", "seperate", "occured", "untill", "wich", "goverment",
+  "begining", "beleive", "truely", "wierd", "adress", "tommorow", 0
+};
+
+const char * const test_modes[] = {"ultra", "fast", "normal", "slow",
+                                   "bad-spellers", 0};
+
+int fail = 0;
+
+static void get_words(const AspellWordList * list, char * buf, size_t size) {
+  AspellStringEnumeration * elements = aspell_word_list_elements(list);
+  const char * word;
+  buf[0] = '\0';
+  while ( (word = aspell_string_enumeration_next(elements)) != NULL ) {
+    if (strlen(buf) + strlen(word) + 2 > size) break;
+    strcat(buf, word);
+    strcat(buf, ",");
+  }
+  delete_aspell_string_enumeration(elements);
+}
+
+static AspellSpeller * new_speller(const char * cache_size) {
+  AspellConfig * spell_config = new_aspell_config();
+  aspell_config_replace(spell_config, "master", "en_US");
+  aspell_config_replace(spell_config, "sug-cache-size", cache_size);
+  AspellCanHaveError * possible_err = new_aspell_speller(spell_config);
+  delete_aspell_config(spell_config);
+  if (aspell_error_number(possible_err) != 0) {
+    fprintf(stderr, "%s", aspell_error_message(possible_err));
+    exit(2);
+  }
+  return to_aspell_speller(possible_err);
+}
+
+/* adds "qzx" to the session after suggest_begin("qzxcat"), suggest
+   must then give the same as a speller which knew it all along */
+static void check_session_change() {
+  static char expected[8192], res[8192];
+  AspellSpeller * spell_checker = new_speller("0");
+  aspell_speller_add_to_session(spell_checker, "qzx", -1);
+  get_words(aspell_speller_suggest(spell_checker, "qzxcat", -1),
+            expected, sizeof(expected));
+  delete_aspell_speller(spell_checker);
+
+  spell_checker = new_speller("100");
+  aspell_speller_suggest_begin(spell_checker, "qzxcat", -1);
+  aspell_speller_add_to_session(spell_checker, "qzx", -1);
+  while (!aspell_speller_suggest_done(spell_checker))
+    aspell_speller_suggest_refine(spell_checker);
+  get_words(aspell_speller_suggest(spell_checker, "qzxcat", -1),
+            res, sizeof(res));
+  if (strcmp(res, expected) != 0) {
+    fprintf(stderr, "fail: qzxcat: expected \"%s\" after adding qzx but got \"%s\"\n",
+            expected, res);
+    fail = 1;
+  }
+  delete_aspell_speller(spell_checker);
+}
+
+int main() {
+  static char expected[8192], res[8192];
+  const char * const * mode;
+  const char * const * word;
+  for (mode = test_modes; *mode; ++mode) {
+    AspellConfig * spell_config = new_aspell_config();
+    aspell_config_replace(spell_config, "master", "en_US");
+    aspell_config_replace(spell_config, "sug-mode", *mode);
+    AspellCanHaveError * possible_err = new_aspell_speller(spell_config);
+    delete_aspell_config(spell_config);
+    if (aspell_error_number(possible_err) != 0) {
+      fprintf(stderr, "%s", aspell_error_message(possible_err));
+      return 2;
+    }
+    AspellSpeller * spell_checker = to_aspell_speller(possible_err);
+    for (word = test_words; *word; ++word) {
+      get_words(aspell_speller_suggest(spell_checker, *word, -1),
+                expected, sizeof(expected));
+      const AspellWordList * suggestions
+        = aspell_speller_suggest_begin(spell_checker, *word, -1);
+      int steps = 0;
+      while (!aspell_speller_suggest_done(spell_checker) && steps < 10) {
+        suggestions = aspell_speller_suggest_refine(spell_checker);
+        ++steps;
+      }
+      if (!aspell_speller_suggest_done(spell_checker)) {
+        fprintf(stderr, "fail: %s (%s): not done after %d steps\n",
+                *word, *mode, steps);
+        fail = 1;
+        continue;
+      }
+      get_words(suggestions, res, sizeof(res));
+      if (strcmp(res, expected) != 0) {
+        fprintf(stderr, "fail: %s (%s): suggest gave \"%s\" but the steps \"%s\"\n",
+                *word, *mode, expected, res);
+        fail = 1;
+      }
+      /* once done refine returns the final list unchanged */
+      get_words(aspell_speller_suggest_refine(spell_checker), res, sizeof(res));
+      if (strcmp(res, expected) != 0) {
+        fprintf(stderr, "fail: %s (%s): list changed after done\n",
+                *word, *mode);
+        fail = 1;
+      }
+    }
+    delete_aspell_speller(spell_checker);
+  }
+  check_session_change();
+  return fail;
+}
@@ -0,0 +1,180 @@
+// Checks that one speller can be shared by several threads, each
+// with its own SpellerImpl::Context, and that so can the data of a
+// speller through clone_speller, which aspell_speller_clone calls,
+// with each thread using its own clone.  The results must be the
+// same as when checking and suggesting from a single thread.
+//
+// Meant to also be run under ThreadSanitizer.
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "config.hpp"
+#include "string.hpp"
+#include "string_enumeration.hpp"
+#include "speller_impl.hpp"
+
+using namespace acommon;
+using namespace aspeller;
+
+static const char * const test_words[] = {
+  "the", "The", "cats", "walked", "swimmer", "teh", "recieve", "swimer",
+  "diagree", "noone", "thier", "acommodate", "definately", "seperate",
+  "occured", "untill", "wich", "goverment", "begining", "beleive", 0
+};
+
+static const unsigned num_threads = 4;
+static const unsigned rounds = 5;
+
+struct Result {
+  bool correct;
+  String suggestions;
+};
+
+static SpellerImpl * speller;
+static Result expected[sizeof(test_words)/sizeof(test_words[0])];
+
+static void get_words(PosibErr<const WordList *> sugs, Result & res)
+{
+  if (sugs.has_err()) return;
+  StringEnumeration * els = sugs.data->elements();
+  const char * w;
+  while ((w = els->next()) != 0) {
+    res.suggestions += w;
+    res.suggestions += ',';
+  }
+  delete els;
+}
+
+// checks and suggests through the shared speller with cx
+static void run(SpellerImpl::Context & cx, unsigned i, Result & res)
+{
+  const SpellerImpl * sp = speller;
+  String word = test_words[i];
+  PosibErr<bool> c = sp->check(MutableString(word.mstr(), word.size()), cx);
+  res.correct = !c.has_err() && c.data;
+  res.suggestions.clear();
+  if (!res.correct)
+    get_words(sp->suggest(MutableString(word.mstr(), word.size()), cx), res);
+}
+
+// checks and suggests with the speller's own methods
+static void run(Speller * sp, unsigned i, Result & res)
+{
+  String word = test_words[i];
+  PosibErr<bool> c = sp->check(MutableString(word.mstr(), word.size()));
+  res.correct = !c.has_err() && c.data;
+  res.suggestions.clear();
+  if (!res.correct)
+    get_words(sp->suggest(MutableString(word.mstr(), word.size())), res);
+}
+
+struct Thread {
+  pthread_t id;
+  Speller * clone; // null to use the shared speller
+  unsigned bad;
+};
+
+static void * thread(void * d)
+{
+  Thread * t = static_cast<Thread *>(d);
+  SpellerImpl::Context cx;
+  Result res;
+  for (unsigned r = 0; r != rounds; ++r) {
+    for (unsigned i = 0; test_words[i]; ++i) {
+      if (t->clone)
+        run(t->clone, i, res);
+      else
+        run(cx, i, res);
+      if (res.correct != expected[i].correct
+          || res.suggestions != expected[i].suggestions)
+        ++t->bad;
+    }
+  }
+  return 0;
+}
+
+static int run_threads(bool clones)
+{
+  Thread threads[num_threads];
+  for (unsigned t = 0; t != num_threads; ++t) {
+    threads[t].bad = 0;
+    threads[t].clone = 0;
+    if (clones) {
+      PosibErr<Speller *> pe = clone_speller(speller, false);
+      if (pe.has_err()) {
+        fprintf(stderr, "fail: clone: %s\n", pe.get_err()->mesg);
+        return 1;
+      }
+      threads[t].clone = pe.data;
+    }
+  }
+  for (unsigned t = 0; t != num_threads; ++t)
+    pthread_create(&threads[t].id, 0, thread, &threads[t]);
+  int fail = 0;
+  for (unsigned t = 0; t != num_threads; ++t) {
+    pthread_join(threads[t].id, 0);
+    if (threads[t].bad) {
+      fprintf(stderr, "fail: %s thread %u got %u different results\n",
+              clones ? "clone" : "context", t, threads[t].bad);
+      fail = 1;
+    }
+    delete threads[t].clone;
+  }
+  return fail;
+}
+
+// a word added to the session of a clone is only known to the
+// original if the word lists are shared
+static int check_shared_word_lists()
+{
+  int fail = 0;
+  for (int share = 0; share != 2; ++share) {
+    PosibErr<Speller *> pe = clone_speller(speller, share);
+    if (pe.has_err()) {
+      fprintf(stderr, "fail: clone: %s\n", pe.get_err()->mesg);
+      return 1;
+    }
+    Speller * clone = pe.data;
+    const char * word = share ? "qzxshared" : "qzxprivate";
+    String w = word;
+    clone->add_to_session(MutableString(w.mstr(), w.size()));
+    w = word;
+    PosibErr<bool> c = speller->check(MutableString(w.mstr(), w.size()));
+    if (c.has_err() || c.data != bool(share)) {
+      fprintf(stderr, "fail: \"%s\" %s by the original\n", word,
+              share ? "not found" : "found");
+      fail = 1;
+    }
+    delete clone;
+  }
+  return fail;
+}
+
+int main()
+{
+  Config * config = new_config();
+  config->replace("master", "en_US");
+  PosibErr<Speller *> pe = new_speller(config);
+  delete config;
+  if (pe.has_err()) {
+    fprintf(stderr, "%s\n", pe.get_err()->mesg);
+    return 2;
+  }
+  speller = static_cast<SpellerImpl *>(pe.data);
+
+  {
+    SpellerImpl::Context cx;
+    for (unsigned i = 0; test_words[i]; ++i)
+      run(cx, i, expected[i]);
+  }
+
+  int fail = 0;
+  fail |= run_threads(false);
+  fail |= run_threads(true);
+  fail |= check_shared_word_lists();
+
+  delete speller;
+  return fail;
+}
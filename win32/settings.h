@@ -28,6 +28,9 @@
 /* Define to 1 if you have the <memory.h> header file. */
 #define HAVE_MEMORY_H 1
 
+/* Defined if mincore is supported */
+/* #undef HAVE_MINCORE */
+
 /* Defined if mmap and friends is supported */
 /* #undef HAVE_MMAP */
 